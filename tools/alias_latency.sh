@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+#
+# Measure the per-call overhead of the wrapper for pure tool aliases
+# (e.g. x86_64-apple-darwinXX-nm -> llvm-nm).
+#
+# Usage: ./alias_latency.sh [iterations] [alias] [tool]
+#   e.g. ./alias_latency.sh 1000 x86_64-apple-darwin20.2-ar llvm-ar
+#
+
+set -e
+
+ITERATIONS=${1:-500}
+ALIAS=${2:-$(ls $(dirname $(command -v osxcross-conf))/*-apple-darwin*-nm | head -n1)}
+TOOL=${3:-llvm-nm}
+
+command -v $ALIAS &>/dev/null || { echo "$ALIAS is not in PATH" 1>&2; exit 1; }
+command -v $TOOL &>/dev/null || { echo "$TOOL is not in PATH" 1>&2; exit 1; }
+
+# Best of 5 rounds; the minimum is the least disturbed by other load.
+function measure()
+{
+  local best=
+
+  for ((round = 0; round < 5; round++)); do
+    local start=$(date +%s%N)
+
+    for ((i = 0; i < ITERATIONS; i++)); do
+      "$@" --version &>/dev/null
+    done
+
+    local end=$(date +%s%N)
+    local t=$(( (end - start) / ITERATIONS / 1000 ))
+    [ -z "$best" -o "$t" -lt "${best:-0}" ] && best=$t
+  done
+
+  echo $best
+}
+
+# Warm up.
+$ALIAS --version &>/dev/null
+$TOOL --version &>/dev/null
+
+DIRECT=$(measure $TOOL)
+WRAPPED=$(measure $ALIAS)
+
+echo "iterations:  $ITERATIONS"
+echo "$TOOL:  $DIRECT us/call"
+echo "$(basename $ALIAS):  $WRAPPED us/call"
+echo "overhead:  $((WRAPPED - DIRECT)) us/call"
@@ -0,0 +1,77 @@
+#!/usr/bin/env bash
+
+#
+# Measure the wrapper's per-invocation latency for long, recorded command
+# lines, where option parsing makes up most of the work.
+#
+# Usage: ./optparse_latency.sh [iterations] [command file]
+#   e.g. ./optparse_latency.sh 200 compile_lines.txt
+#
+# The command file holds one command line per line, e.g. as printed by
+# 'make V=1' or 'ninja -v' (o64-clang++ -I... -D... -c foo.cpp).
+# Without a command file, a 2000 argument compile line is synthesized.
+#
+# BASELINE=<path to another wrapper binary> (env) measures that binary too.
+# The compiler itself is never executed (OSXCROSS_UNIT_TEST=2).
+#
+
+set -e
+
+ITERATIONS=${1:-200}
+COMMANDS=$2
+WRAPPER=$(ls $(dirname $(command -v osxcross-conf))/*-wrapper | head -n1)
+
+[ -x "$WRAPPER" ] || { echo "cannot find the wrapper binary" 1>&2; exit 1; }
+
+TMPDIR=$(mktemp -d)
+trap "rm -rf $TMPDIR" EXIT
+
+if [ -z "$COMMANDS" ]; then
+  COMMANDS=$TMPDIR/commands
+  {
+    echo -n "o64-clang++ -c test.cpp -o test.o"
+    for ((i = 0; i < 500; ++i)); do
+      echo -n " -I/src/include$i -DDEFINE_$i=1 -Wno-warning-$i -fno-feature-$i"
+    done
+    echo
+  } > $COMMANDS
+fi
+
+# Keep setup() out of the measurement.
+export OSXCROSS_SETUP_CACHE_DIR=$TMPDIR/cache
+export OSXCROSS_NO_INCLUDE_PATH_WARNINGS=1
+export OSXCROSS_UNIT_TEST=2
+unset OCDEBUG
+
+# Best of 5 rounds; the minimum is the least disturbed by other load.
+function measure()
+{
+  local best=
+
+  for ((round = 0; round < 5; round++)); do
+    local start=$(date +%s%N)
+    local n=0
+
+    while read -r -a cmd; do
+      for ((i = 0; i < ITERATIONS; i++)); do
+        OSXCROSS_PROG_NAME=${cmd[0]} $1 "${cmd[@]:1}" >/dev/null
+      done
+      n=$((n + ITERATIONS))
+    done < $COMMANDS
+
+    local end=$(date +%s%N)
+    local t=$(( (end - start) / n / 1000 ))
+    [ -z "$best" -o "$t" -lt "${best:-0}" ] && best=$t
+  done
+
+  echo $best
+}
+
+echo "command lines:  $(wc -l < $COMMANDS)"
+echo "arguments:      $(wc -w < $COMMANDS)"
+echo "iterations:     $ITERATIONS"
+
+for wrapper in $WRAPPER $BASELINE; do
+  measure $wrapper >/dev/null # warm up
+  echo "$wrapper:  $(measure $wrapper) us/invocation"
+done
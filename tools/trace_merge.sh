@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+
+#
+# Merge the per-invocation trace files written with OSXCROSS_TRACE=<dir>
+# into one Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+#
+# Usage: ./trace_merge.sh <trace dir> [output file]
+#   e.g. OSXCROSS_TRACE=/tmp/trace make -j8
+#        ./trace_merge.sh /tmp/trace build.json
+#
+# Prints the number of invocations and the total time spent in the wrapper.
+#
+
+set -e
+
+TRACEDIR=$1
+OUTPUT=${2:-/dev/stdout}
+
+if [ -z "$TRACEDIR" ] || [ ! -d "$TRACEDIR" ]; then
+  echo "usage: $0 <trace dir> [output file]" 1>&2
+  exit 1
+fi
+
+# Every trace file holds one event per line between its first and last line.
+find "$TRACEDIR" -name '*.json' -type f -print0 | xargs -0 -r cat | awk '
+  BEGIN { printf("{\"traceEvents\":[\n") }
+  /^\{"traceEvents":\[/ || /^\]\}/ { next }
+  {
+    sub(/,[[:space:]]*$/, "")
+    if (n++) printf(",\n")
+    printf("%s", $0)
+
+    if (index($0, "{\"name\":\"wrapper\",") == 1 &&
+        match($0, /"dur":[0-9.]+/)) {
+      invocations++
+      total += substr($0, RSTART + 6, RLENGTH - 6)
+    }
+  }
+  END {
+    printf("\n],\"displayTimeUnit\":\"ms\"}\n")
+    printf("invocations: %d\n", invocations) > "/dev/stderr"
+    printf("time spent in wrapper: %.3f ms\n", total / 1000) > "/dev/stderr"
+  }' > "$OUTPUT"
@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+
+#
+# Compare the latency of the wrapper resolving invocations in-process
+# (with and without the setup cache) with the latency of it asking
+# osxcross-wrapperd.
+#
+# Usage: ./wrapperd_latency.sh [iterations] [command...]
+#   e.g. ./wrapperd_latency.sh 1000 o64-clang++ -c test.cpp
+#
+# The compiler itself is never executed (OSXCROSS_UNIT_TEST=2).
+#
+
+set -e
+
+ITERATIONS=${1:-500}
+shift || true
+
+if [ $# -eq 0 ]; then
+  set -- o64-clang -c test.c
+fi
+
+command -v osxcross-wrapperd &>/dev/null || {
+  echo "osxcross-wrapperd is not in PATH" 1>&2
+  exit 1
+}
+
+TMPDIR=$(mktemp -d)
+SOCKET=$TMPDIR/wrapperd.sock
+DAEMON_PID=
+
+function cleanup()
+{
+  [ -n "$DAEMON_PID" ] && kill $DAEMON_PID 2>/dev/null || true
+  rm -rf $TMPDIR
+}
+
+trap cleanup EXIT
+
+function measure()
+{
+  local start=$(date +%s%N)
+
+  for ((i = 0; i < ITERATIONS; i++)); do
+    "$@" >/dev/null
+  done
+
+  local end=$(date +%s%N)
+  echo $(( (end - start) / ITERATIONS / 1000 ))
+}
+
+export OSXCROSS_UNIT_TEST=2
+unset OSXCROSS_WRAPPERD_SOCKET OSXCROSS_SETUP_CACHE_DIR
+
+osxcross-wrapperd $SOCKET 2>/dev/null &
+DAEMON_PID=$!
+
+while [ ! -S $SOCKET ]; do
+  sleep 0.05
+done
+
+# Warm up all paths.
+"$@" >/dev/null
+OSXCROSS_SETUP_CACHE_DIR=$TMPDIR/setup-cache "$@" >/dev/null
+OSXCROSS_WRAPPERD_SOCKET=$SOCKET "$@" >/dev/null
+
+INPROCESS=$(measure "$@")
+CACHED=$(OSXCROSS_SETUP_CACHE_DIR=$TMPDIR/setup-cache measure "$@")
+DAEMON=$(OSXCROSS_WRAPPERD_SOCKET=$SOCKET measure "$@")
+
+echo "command:       $*"
+echo "iterations:    $ITERATIONS"
+echo "in-process:    $INPROCESS us/invocation"
+echo "setup cache:   $CACHED us/invocation"
+echo "wrapperd:      $DAEMON us/invocation"
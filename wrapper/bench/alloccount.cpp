@@ -0,0 +1,124 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * LD_PRELOAD library counting the heap allocations of a process
+ * (glibc only). The count is written as a line to the file descriptor
+ * named by OSXCROSS_BENCH_ALLOC_FD (env) when the process exits or
+ * executes another program.
+ *
+ * Used by bench/replay; see bench/run.sh.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <dlfcn.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+
+unsigned long long allocations;
+pid_t owner;
+
+__attribute__((constructor)) void init() { owner = getpid(); }
+
+// Reports once, and only for the process the library was loaded into
+// (not for forked children).
+void report() {
+  const char *fd = getenv("OSXCROSS_BENCH_ALLOC_FD");
+  char buf[32];
+
+  if (!fd || getpid() != owner)
+    return;
+
+  int len = snprintf(buf, sizeof(buf), "%llu\n", allocations);
+
+  if (write(atoi(fd), buf, len) != len)
+    return;
+
+  unsetenv("OSXCROSS_BENCH_ALLOC_FD");
+}
+
+__attribute__((destructor)) void fini() { report(); }
+
+template <typename T> T next(const char *name) {
+  return reinterpret_cast<T>(dlsym(RTLD_NEXT, name));
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+void *malloc(size_t size) {
+  ++allocations;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  ++allocations;
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  ++allocations;
+  return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  ++allocations;
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  ++allocations;
+  return __libc_memalign(alignment, size);
+}
+
+int execv(const char *path, char *const argv[]) {
+  report();
+  return next<int (*)(const char *, char *const[])>("execv")(path, argv);
+}
+
+int execvp(const char *file, char *const argv[]) {
+  report();
+  return next<int (*)(const char *, char *const[])>("execvp")(file, argv);
+}
+
+int execve(const char *path, char *const argv[], char *const envp[]) {
+  report();
+  return next<int (*)(const char *, char *const[], char *const[])>(
+      "execve")(path, argv, envp);
+}
+
+} // extern "C"
@@ -0,0 +1,113 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * Microbenchmark of program name dispatch: program::getprog() and xcrun's
+ * Xcode tool lookup (program::findprog()) against a linear scan of
+ * programs[].
+ *
+ * Build and run: make dispatch_bench && ./dispatch_bench [iterations]
+ */
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+
+#include "tools.h"
+#include "target.h"
+#include "progs.h"
+
+using namespace tools;
+
+namespace {
+
+// Names getprog() and isXcodeTool() are called with in practice:
+// argv[0], compiler names and xcrun -f/-r arguments.
+const char *const Misses[] = {
+  "x86_64-apple-darwin24-clang", "x86_64-apple-darwin24-clang++",
+  "o64-clang", "o64-clang++", "oa64-clang", "clang++-libc++", "gcc-14",
+  "git", "sh", "make", "cmake", "osxcross-wrapperd", "zzz"
+};
+
+const program::prog *linearScan(const char *name) {
+  for (auto &p : program::programs)
+    if (p == name)
+      return &p;
+
+  return nullptr;
+}
+
+template <typename Lookup>
+double measure(const std::vector<const char *> &names, size_t iterations,
+               Lookup lookup) {
+  uintptr_t sum = 0;
+  time_type start = getNanoSeconds();
+
+  for (size_t i = 0; i < iterations; ++i)
+    for (const char *name : names)
+      sum += reinterpret_cast<uintptr_t>(lookup(name));
+
+  time_type diff = getNanoSeconds() - start;
+
+  // Keep the lookups from being optimized away.
+  if (sum == 1)
+    std::cout << std::endl;
+
+  return static_cast<double>(diff) / (iterations * names.size());
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  size_t iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+  std::vector<const char *> names;
+
+  for (auto &p : program::programs)
+    names.push_back(p.name);
+
+  for (const char *name : Misses)
+    names.push_back(name);
+
+  std::cout << "names:      " << names.size() << " ("
+            << program::numPrograms << " known)" << std::endl;
+  std::cout << "iterations: " << iterations << std::endl;
+
+  std::cout << "linear scan: "
+            << measure(names, iterations, linearScan) << " ns/lookup"
+            << std::endl;
+  std::cout << "getprog():   "
+            << measure(names, iterations,
+                       [](const char *name) {
+                         return program::getprog(name);
+                       })
+            << " ns/lookup" << std::endl;
+  std::cout << "findprog():  "
+            << measure(names, iterations, program::findprog)
+            << " ns/lookup" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,377 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * Replays a corpus of wrapper command lines with OSXCROSS_UNIT_TEST=2
+ * (stop before exec) and reports wall time percentiles, CPU time,
+ * instructions (Linux perf events, if available) and allocations
+ * (with alloccount.so preloaded) per scenario.
+ *
+ * Usage: replay [-n runs] [-w warmup runs] [-o results] [-b baseline]
+ *               <corpus>
+ *
+ * Corpus lines are '<scenario>: <command> [args...]'; '#' starts a comment.
+ * Results are written as '<scenario> <p50> <p95> <p99> <cpu> <instructions>
+ * <allocations>' lines, which can be passed back in as baseline.
+ *
+ * Normally run through 'make bench' (see bench/run.sh).
+ */
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+extern char **environ;
+
+namespace {
+
+typedef unsigned long long time_type;
+
+time_type getNanoSeconds() {
+  struct timespec tp;
+  clock_gettime(CLOCK_MONOTONIC, &tp);
+  return tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+struct Scenario {
+  std::string name;
+  std::vector<std::string> args;
+};
+
+struct Result {
+  double p50, p95, p99; // us
+  double cpu;           // us, median
+  double instructions;  // median, -1 if unavailable
+  double allocations;   // median, -1 if unavailable
+  int status;
+};
+
+typedef std::map<std::string, Result> Results;
+
+int openInstructionCounter() {
+#ifdef __linux__
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.inherit = 1; // count the spawned wrapper
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+long long readCounter(int fd) {
+  long long value;
+
+  if (fd == -1 || read(fd, &value, sizeof(value)) != sizeof(value))
+    return -1;
+
+  return value;
+}
+
+bool readCorpus(const char *file, std::vector<Scenario> &corpus) {
+  std::ifstream f(file);
+  std::string line;
+
+  if (!f.is_open())
+    return false;
+
+  while (std::getline(f, line)) {
+    size_t colon = line.find(':');
+
+    if (line.empty() || line[0] == '#' || colon == std::string::npos)
+      continue;
+
+    Scenario scenario;
+    std::istringstream words(line.substr(colon + 1));
+    std::string word;
+
+    scenario.name = line.substr(0, colon);
+
+    while (words >> word)
+      scenario.args.push_back(word);
+
+    if (!scenario.args.empty())
+      corpus.push_back(scenario);
+  }
+
+  return true;
+}
+
+bool readResults(const char *file, Results &results) {
+  std::ifstream f(file);
+  std::string name;
+  Result r = Result();
+
+  if (!f.is_open())
+    return false;
+
+  while (f >> name >> r.p50 >> r.p95 >> r.p99 >> r.cpu >> r.instructions >>
+         r.allocations)
+    results[name] = r;
+
+  return true;
+}
+
+double median(std::vector<double> &v) {
+  if (v.empty())
+    return -1;
+
+  std::sort(v.begin(), v.end());
+  return v[v.size() / 2];
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+  size_t i = static_cast<size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, i ? i - 1 : 0)];
+}
+
+// Runs the scenario once. Returns false if it could not be spawned.
+bool runOnce(const Scenario &scenario, int counterfd, int allocfd,
+             double &wall, double &cpu, double &instructions,
+             double &allocations, int &status) {
+  std::vector<char *> argv;
+
+  for (auto &arg : scenario.args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+
+  argv.push_back(nullptr);
+
+  long long before = readCounter(counterfd);
+  time_type start = getNanoSeconds();
+  pid_t pid;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+
+  int rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(),
+                        environ);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if (rc)
+    return false;
+
+  struct rusage usage;
+
+  if (wait4(pid, &status, 0, &usage) != pid)
+    return false;
+
+  wall = (getNanoSeconds() - start) / 1000.0;
+  cpu = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec +
+        usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+
+  long long after = readCounter(counterfd);
+  instructions = before != -1 && after != -1 ? after - before : -1;
+
+  // alloccount.so reports one line per process image; the first one is
+  // the wrapper's. Drain the rest.
+  char buf[256];
+  ssize_t n = allocfd != -1 ? read(allocfd, buf, sizeof(buf) - 1) : -1;
+  allocations = -1;
+
+  if (n > 0) {
+    buf[n] = '\0';
+    allocations = atof(buf);
+
+    while (read(allocfd, buf, sizeof(buf)) > 0)
+      ;
+  }
+
+  status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  return true;
+}
+
+bool run(const Scenario &scenario, size_t runs, size_t warmup,
+         int counterfd, int allocfd, Result &result) {
+  std::vector<double> walls, cpus, instructions, allocations;
+
+  for (size_t i = 0; i < warmup + runs; ++i) {
+    double wall, cpu, instr, allocs;
+
+    if (!runOnce(scenario, counterfd, allocfd, wall, cpu, instr, allocs,
+                 result.status))
+      return false;
+
+    if (i < warmup)
+      continue;
+
+    walls.push_back(wall);
+    cpus.push_back(cpu);
+
+    if (instr >= 0)
+      instructions.push_back(instr);
+
+    if (allocs >= 0)
+      allocations.push_back(allocs);
+  }
+
+  std::sort(walls.begin(), walls.end());
+
+  result.p50 = percentile(walls, 0.50);
+  result.p95 = percentile(walls, 0.95);
+  result.p99 = percentile(walls, 0.99);
+  result.cpu = median(cpus);
+  result.instructions = median(instructions);
+  result.allocations = median(allocations);
+  return true;
+}
+
+std::string format(double value, const Result *baseline, double base) {
+  char buf[64];
+
+  if (value < 0)
+    return "-";
+
+  if (baseline && base > 0)
+    snprintf(buf, sizeof(buf), "%.0f (%+.1f%%)", value,
+             (value - base) * 100.0 / base);
+  else
+    snprintf(buf, sizeof(buf), "%.0f", value);
+
+  return buf;
+}
+
+void usage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " [-n runs] [-w warmup runs] "
+            << "[-o results] [-b baseline] <corpus>" << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  size_t runs = 1000;
+  size_t warmup = 20;
+  const char *output = nullptr;
+  const char *baselinefile = nullptr;
+  std::vector<Scenario> corpus;
+  Results baseline;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:w:o:b:")) != -1) {
+    switch (opt) {
+    case 'n': runs = strtoul(optarg, nullptr, 10); break;
+    case 'w': warmup = strtoul(optarg, nullptr, 10); break;
+    case 'o': output = optarg; break;
+    case 'b': baselinefile = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+
+  if (optind != argc - 1 || !runs)
+    usage(argv[0]);
+
+  if (!readCorpus(argv[optind], corpus)) {
+    std::cerr << "cannot read corpus '" << argv[optind] << "'" << std::endl;
+    return 1;
+  }
+
+  if (baselinefile && !readResults(baselinefile, baseline))
+    baselinefile = nullptr;
+
+  setenv("OSXCROSS_UNIT_TEST", "2", 1);
+
+  int counterfd = openInstructionCounter();
+  int allocpipe[2];
+  int allocfd = -1;
+
+  const char *preload = getenv("LD_PRELOAD");
+
+  if (preload && *preload && !pipe(allocpipe)) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", allocpipe[1]);
+    setenv("OSXCROSS_BENCH_ALLOC_FD", buf, 1);
+    fcntl(allocpipe[0], F_SETFL, O_NONBLOCK);
+    allocfd = allocpipe[0];
+  }
+
+  std::ofstream results;
+
+  if (output)
+    results.open(output);
+
+  printf("%zu runs per scenario%s\n\n", runs,
+         baselinefile ? ", (+/-%) relative to baseline" : "");
+  printf("%-18s %4s %16s %16s %16s %16s %18s %14s\n", "scenario", "exit",
+         "p50 us", "p95 us", "p99 us", "cpu us", "instructions",
+         "allocations");
+
+  for (auto &scenario : corpus) {
+    Result r = Result();
+
+    if (!run(scenario, runs, warmup, counterfd, allocfd, r)) {
+      printf("%-18s cannot execute '%s'\n", scenario.name.c_str(),
+             scenario.args[0].c_str());
+      continue;
+    }
+
+    auto it = baseline.find(scenario.name);
+    const Result *b = it != baseline.end() ? &it->second : nullptr;
+
+    printf("%-18s %4d %16s %16s %16s %16s %18s %14s\n",
+           scenario.name.c_str(), r.status,
+           format(r.p50, b, b ? b->p50 : 0).c_str(),
+           format(r.p95, b, b ? b->p95 : 0).c_str(),
+           format(r.p99, b, b ? b->p99 : 0).c_str(),
+           format(r.cpu, b, b ? b->cpu : 0).c_str(),
+           format(r.instructions, b, b ? b->instructions : 0).c_str(),
+           format(r.allocations, b, b ? b->allocations : 0).c_str());
+    fflush(stdout);
+
+    if (results.is_open())
+      results << scenario.name << " " << r.p50 << " " << r.p95 << " "
+              << r.p99 << " " << r.cpu << " " << r.instructions << " "
+              << r.allocations << "\n";
+  }
+
+  return 0;
+}
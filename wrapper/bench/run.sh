@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+
+#
+# Replays bench/corpus.txt against the freshly built wrapper.
+# Invoked by 'make bench' / 'make bench-baseline'.
+#
+# Usage: ./bench/run.sh <wrapper> <triple> <target dir> <results file>
+#                       [baseline file] [runs]
+#
+# The wrapper is installed into a scratch directory next to the SDK and
+# the other contents of <target dir> (the installed osxcross 'target'
+# directory), so the installed toolchain is left alone. The compiler
+# itself is never executed (OSXCROSS_UNIT_TEST=2).
+#
+
+set -e
+
+BENCHDIR=$(cd $(dirname $0) && pwd)
+WRAPPER=$(realpath $1)
+TRIPLE=$2
+TARGET_DIR=$(realpath $3)
+RESULTS=$(realpath -m $4)
+BASELINE=$5
+RUNS=${6:-1000}
+
+if [ ! -x "$WRAPPER" ] || [ -z "$TRIPLE" ] || [ ! -d "$TARGET_DIR/SDK" ]; then
+  echo "usage: $0 <wrapper> <triple> <target dir> <results> [baseline] [runs]" 1>&2
+  exit 1
+fi
+
+TMPDIR=$(mktemp -d)
+trap "rm -rf $TMPDIR" EXIT
+
+for f in $TARGET_DIR/*; do
+  [ $(basename $f) != bin ] && ln -s $f $TMPDIR/
+done
+
+mkdir $TMPDIR/bin $TMPDIR/work
+cp $WRAPPER $TMPDIR/bin/$TRIPLE-wrapper
+
+sed "s/@TRIPLE@/$TRIPLE/g" $BENCHDIR/corpus.txt > $TMPDIR/corpus.txt
+
+for cmd in $(sed -n 's/^[^#][^:]*: *\([^ ]*\).*/\1/p' $TMPDIR/corpus.txt); do
+  [ -e $TMPDIR/bin/$cmd ] || ln -s $TRIPLE-wrapper $TMPDIR/bin/$cmd
+done
+
+echo "int main() { return 0; }" > $TMPDIR/work/test.c
+echo "int main() { return 0; }" > $TMPDIR/work/test.cpp
+touch $TMPDIR/work/test.o
+
+# Measure the wrapper, not the caches or the environment of the caller.
+unset OCDEBUG OSXCROSS_SETUP_CACHE_DIR OSXCROSS_WRAPPERD_SOCKET
+unset OSXCROSS_TRACE OSXCROSS_PROBE_LOG OSXCROSS_RESOLVED_TARGET
+unset OSXCROSS_SDKROOT OSXCROSS_SDK_SEARCH_DIR
+export OSXCROSS_NO_INCLUDE_PATH_WARNINGS=1
+export PATH=$TMPDIR/bin:$PATH
+
+if [ -n "$BASELINE" ]; then
+  if [ -f "$BASELINE" ]; then
+    BASELINE=$(realpath $BASELINE)
+  else
+    echo "no baseline; run 'make bench-baseline' first" 1>&2
+    BASELINE=
+  fi
+fi
+
+cd $TMPDIR/work
+
+# Allocation counting preloads bench/alloccount.so, which static wrappers
+# (STATIC=1/pie) ignore and which skews comparisons with them.
+PRELOAD=
+[ "$BENCH_ALLOCS" != 0 ] && PRELOAD=$BENCHDIR/alloccount.so
+
+LD_PRELOAD=$PRELOAD \
+  $BENCHDIR/replay -n $RUNS -o $RESULTS ${BASELINE:+-b $BASELINE} \
+  $TMPDIR/corpus.txt
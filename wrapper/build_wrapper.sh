@@ -63,15 +63,46 @@ if [ "$PLATFORM" == "Linux" ]; then
   FLAGS+="-isystem quirks/include "
 fi
 
+# STATIC=1 or STATIC=pie links the wrapper statically, which saves the
+# dynamic loader's work on every compiler invocation (see Makefile).
+if [ "$PLATFORM" == "Darwin" ] && [ -n "$STATIC" ] && [ "$STATIC" != "0" ]; then
+  echo "STATIC is not supported on Darwin, ignoring it" 1>&2
+  STATIC=0
+fi
+
+# PGO=1 builds a profile-guided wrapper, trained by replaying
+# bench/corpus.txt against the SDK in TARGET_DIR; BOLT=1 adds an llvm-bolt
+# pass (see Makefile). Both need to run the freshly built wrapper.
+WRAPPER_GOAL=wrapper
+
+if [ "$PGO" == "1" ]; then
+  if [ -n "$BWCOMPILEONLY" ] || [ ! -d "${TARGET_DIR}/SDK" ]; then
+    echo "PGO needs a native build and an SDK in ${TARGET_DIR}/SDK," \
+         "ignoring it" 1>&2
+  else
+    WRAPPER_GOAL=pgo
+  fi
+fi
+
+if [ "$BOLT" == "1" ]; then
+  if [ $WRAPPER_GOAL != pgo ] || ! command -v ${LLVM_BOLT:-llvm-bolt} &>/dev/null
+  then
+    echo "BOLT needs PGO=1 and llvm-bolt, ignoring it" 1>&2
+    BOLT=0
+  fi
+fi
+
 # Create the installation directory, clean the previous wrapper build and
 # compile with the configured flags.
 mkdir -p ${TARGET_DIR}/bin
 export PLATFORM
 export CXX
+export STATIC=${STATIC:-0}
+export BOLT=${BOLT:-0}
 
 verbose_cmd $MAKE clean
 ADDITIONAL_CXXFLAGS="$FLAGS" \
-  verbose_cmd $MAKE wrapper -j$JOBS
+  verbose_cmd $MAKE $WRAPPER_GOAL -j$JOBS
 
 if [ -n "$BWCOMPILEONLY" ]; then
   exit 0
@@ -274,8 +305,14 @@ fi
 
 install_program_links osxcross "$SUPPORTED_ARCHS" enable_standalone
 install_program_links osxcross-conf "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-cache "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-compdb "$SUPPORTED_ARCHS" enable_standalone
 install_program_links osxcross-env "$SUPPORTED_ARCHS" enable_standalone
 install_program_links osxcross-man "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-manifest "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-pack-toolchain "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-resolve "$SUPPORTED_ARCHS" enable_standalone
+install_program_links osxcross-wrapperd "$SUPPORTED_ARCHS" enable_standalone
 install_program_links pkg-config "$SUPPORTED_ARCHS"
 
 # Darwin provides these tools itself. Other hosts need wrapper links.
@@ -286,5 +323,9 @@ if [ "$PLATFORM" != "Darwin" ]; then
   install_program_links xcodebuild "$SUPPORTED_ARCHS" enable_standalone
 fi
 
+# Record the toolchain layout (tool locations, clang intrinsic headers, GCC
+# versions), so the wrapper does not have to probe it on every invocation.
+verbose_cmd ./osxcross-manifest
+
 popd &>/dev/null
 popd &>/dev/null
@@ -0,0 +1,251 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
+
+#include "tools.h"
+#include "target.h"
+#include "cache.h"
+
+extern int debug;
+
+namespace cache {
+
+using namespace tools;
+using namespace target;
+
+namespace {
+
+constexpr const char *SetupCacheMagic = "osxcross-setup-cache-4";
+
+// Environment variables Target::setup() reads. MACOSX_DEPLOYMENT_TARGET is
+// not listed; it has already been folded into Target::OSNum at this point.
+constexpr const char *SetupEnvVars[] = {
+  "OSXCROSS_SDKROOT",
+  "OSXCROSS_SDK_SEARCH_DIR",
+  "OSXCROSS_MP_INC",
+  "OSXCROSS_GCC_NO_STATIC_RUNTIME",
+  "OSXCROSS_PRETEND_TO_BE_APPLE_CLANG",
+  "OSXCROSS_ENABLE_WERROR_IMPLICIT_FUNCTION_DECLARATION",
+  "OSXCROSS_NO_10_5_DEPRECATION_WARNING",
+  "PATH"
+};
+
+void addKey(std::string &key, const char *name, const std::string &value) {
+  key += name;
+  key += '=';
+  key += value;
+  key += '\0';
+}
+
+void addKey(std::string &key, const char *name, long long value) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%lld", value);
+  addKey(key, name, std::string(buf));
+}
+
+std::string getEntryPath(const char *cachedir, const std::string &key) {
+  std::string path = cachedir;
+  path += PATHDIV;
+  path += hashToString(hashString(key));
+  return path;
+}
+
+} // anonymous namespace
+
+const char *getSetupCacheDir() {
+  const char *dir = getenv("OSXCROSS_SETUP_CACHE_DIR");
+  return dir && *dir ? dir : nullptr;
+}
+
+// The key covers everything setup() derives its result from, apart from the
+// file system state, which is validated through the stored dependencies.
+void getSetupKey(const Target &target, std::string &key) {
+  key = SetupCacheMagic;
+  key += '\0';
+
+  addKey(key, "version", getOSXCrossVersion());
+  addKey(key, "execpath", target.execpath);
+  addKey(key, "arch", target.arch);
+
+  for (auto arch : target.targetarchs)
+    addKey(key, "targetarch", arch);
+
+  addKey(key, "target", target.target);
+  addKey(key, "compiler", target.compiler);
+  addKey(key, "compilername", target.compilername);
+  addKey(key, "compilerpath", target.compilerpath);
+  addKey(key, "intrinsicpath", target.intrinsicpath);
+  addKey(key, "osnum", target.OSNum.Num());
+  addKey(key, "stdlib", target.stdlib);
+  addKey(key, "usegcclibs", target.usegcclibs);
+  addKey(key, "wliblto", target.wliblto);
+  addKey(key, "language", target.language ? target.language : "");
+
+  // Argument classes setup() looks at.
+  addKey(key, "mode", static_cast<int>(target.mode));
+  addKey(key, "objectinputsonly", target.objectInputsOnly);
+
+  for (const char *var : SetupEnvVars) {
+    if (const char *val = getenv(var))
+      addKey(key, var, val);
+    else
+      addKey(key, var, "<unset>");
+  }
+}
+
+void getSetupEnvironment(string_vector &vars) {
+  for (const char *var : SetupEnvVars) {
+    vars.push_back(var);
+
+    if (const char *val = getenv(var)) {
+      vars.back() += '=';
+      vars.back() += val;
+    }
+  }
+}
+
+// Entries are a sequence of records (see tools::putRecord()): magic, key,
+// dependency stamps and the setup() result.
+bool loadSetupEntry(const std::string &entry, const std::string &key,
+                    Target &target) {
+  const char *p = entry.c_str();
+  const char *end = p + entry.size();
+
+  std::string str;
+  string_vector deps;
+  string_vector fargs;
+  string_vector args;
+  string_vector environment;
+  std::string compilerpath;
+  std::string triple;
+  std::string OSNum;
+  std::string clangversion;
+  size_t stdlib;
+
+  if (!getRecord(p, end, str) || str != SetupCacheMagic)
+    return false;
+
+  if (!getRecord(p, end, str) || str != key)
+    return false; // hash collision
+
+  if (!getRecord(p, end, deps) || deps.size() % 2)
+    return false;
+
+  for (size_t i = 0; i < deps.size(); i += 2) {
+    getFileStamp(deps[i], str);
+
+    if (str != deps[i + 1]) {
+      if (debug >= 2)
+        dbg << "setup cache: '" << deps[i] << "' changed" << dbg.endl();
+      return false;
+    }
+  }
+
+  if (!getRecord(p, end, compilerpath) || !getRecord(p, end, triple) ||
+      !getRecord(p, end, OSNum) || !getRecord(p, end, clangversion) ||
+      !getRecord(p, end, stdlib) || !getRecord(p, end, fargs) ||
+      !getRecord(p, end, args) || !getRecord(p, end, environment) ||
+      environment.size() % 2)
+    return false;
+
+  target.compilerpath.swap(compilerpath);
+  target.triple.swap(triple);
+  target.OSNum = parseOSVersion(OSNum.c_str());
+  target.clangversion = parseClangVersion(clangversion.c_str());
+  target.stdlib = static_cast<StdLib>(stdlib);
+  target.fargs.swap(fargs);
+  target.args.insert(target.args.end(), args.begin(), args.end());
+
+  for (size_t i = 0; i < environment.size(); i += 2)
+    target.setEnv(environment[i].c_str(), environment[i + 1]);
+
+  return true;
+}
+
+// 'numargs' is the size of Target::args before setup() was run; setup() may
+// append arguments that must be replayed on a hit.
+void getSetupEntry(const std::string &key, const Target &target,
+                   size_t numargs, std::string &entry) {
+  std::string stamp;
+  string_vector deps;
+  const char *SDKSearchDir = getSDKSearchDir();
+
+  if (!getenv("OSXCROSS_SDKROOT") && SDKSearchDir[0]) {
+    deps.push_back(SDKSearchDir);
+    getFileStamp(SDKSearchDir, stamp);
+    deps.push_back(stamp);
+  }
+
+  for (auto &dep : target.dependencies) {
+    deps.push_back(dep);
+    getFileStamp(dep, stamp);
+    deps.push_back(stamp);
+  }
+
+  entry.clear();
+
+  putRecord(entry, std::string(SetupCacheMagic));
+  putRecord(entry, key);
+  putRecord(entry, deps);
+  putRecord(entry, target.compilerpath);
+  putRecord(entry, target.triple);
+  putRecord(entry, target.OSNum.Str());
+  putRecord(entry, target.clangversion.Str());
+  putRecord(entry, static_cast<size_t>(target.stdlib));
+  putRecord(entry, target.fargs);
+  putRecord(entry,
+            string_vector(target.args.begin() + numargs, target.args.end()));
+  putRecord(entry, target.environment);
+}
+
+bool loadSetup(const char *cachedir, const std::string &key, Target &target) {
+  std::string path = getEntryPath(cachedir, key);
+  std::string entry;
+
+  if (!getFileContent(path, entry) || !loadSetupEntry(entry, key, target))
+    return false;
+
+  if (debug >= 2)
+    dbg << "setup cache: hit (" << path << ")" << dbg.endl();
+
+  return true;
+}
+
+void storeSetup(const char *cachedir, const std::string &key,
+                const std::string &entry) {
+  if (!createDirectory(cachedir) ||
+      !writeFileContentAtomic(getEntryPath(cachedir, key), entry)) {
+    if (debug)
+      dbg << "setup cache: cannot write to '" << cachedir << "'"
+          << dbg.endl();
+  }
+}
+
+} // namespace cache
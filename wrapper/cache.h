@@ -0,0 +1,57 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace target {
+struct Target;
+}
+
+namespace cache {
+
+using target::Target;
+using tools::string_vector;
+
+//
+// Setup cache
+//
+// Target::setup() gives the same answer for the same wrapper, arguments and
+// environment as long as the SDK and compiler installation do not change.
+// When 'OSXCROSS_SETUP_CACHE_DIR' (env) is set, the final compiler path and
+// fargs are stored there and reused by subsequent invocations.
+//
+
+const char *getSetupCacheDir();
+
+void getSetupKey(const Target &target, std::string &key);
+
+// The environment variables setup() reads, as "NAME=value" ("NAME" if
+// unset). Also part of the compile cache key.
+void getSetupEnvironment(string_vector &vars);
+
+bool loadSetupEntry(const std::string &entry, const std::string &key,
+                    Target &target);
+void getSetupEntry(const std::string &key, const Target &target,
+                   size_t numargs, std::string &entry);
+
+bool loadSetup(const char *cachedir, const std::string &key, Target &target);
+void storeSetup(const char *cachedir, const std::string &key,
+                const std::string &entry);
+
+} // namespace cache
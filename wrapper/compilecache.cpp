@@ -0,0 +1,674 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/time.h>
+
+#include "tools.h"
+#include "target.h"
+#include "trace.h"
+#include "driver.h"
+#include "fanout.h"
+#include "cache.h"
+#include "compilecache.h"
+
+extern int debug;
+
+namespace compilecache {
+
+using namespace tools;
+using target::DriverMode;
+
+namespace {
+
+constexpr const char CompileCacheMagic[] = "osxcross-compile-cache-1";
+constexpr const char *CounterNames[] = { "hits", "misses", "uncacheable",
+                                         "size" };
+
+// Environment variables that change the object file without showing up in
+// the command or the preprocessed source, in addition to the ones setup()
+// reads.
+constexpr const char *CompileEnvVars[] = {
+  "MACOSX_DEPLOYMENT_TARGET",
+  "SOURCE_DATE_EPOCH"
+};
+
+// Left behind by writeFileContentAtomic() of crashed invocations.
+constexpr time_t StaleTempFileAge = 3600;
+
+struct Job {
+  std::string path; // entry
+  std::string key;
+  std::string output;
+  std::string depfile; // empty: none requested
+};
+
+bool startsWith(const std::string &str, const char *prefix) {
+  return !str.compare(0, strlen(prefix), prefix);
+}
+
+// Invocations with outputs besides the object and dependency files, or with
+// inputs the preprocessed source does not cover.
+bool isUncacheable(const std::string &arg) {
+  constexpr const char *Options[] = {
+    "-save-temps", "--serialize-diagnostics", "-ftime-trace", "-MJ",
+    "-gsplit-dwarf", "-fmodules", "-include-pch", "-emit-pch",
+    // .gcno files
+    "--coverage", "-ftest-coverage",
+    // files read by the compiler itself
+    "-fprofile-use", "-fprofile-instr-use", "-fprofile-sample-use",
+    "-fprofile-list=", "-fsanitize-ignorelist=", "-fsanitize-blacklist=",
+    "-fplugin", "-fpass-plugin="
+  };
+
+  if (arg == "-")
+    return true; // stdin
+
+  for (const char *opt : Options) {
+    if (startsWith(arg, opt))
+      return true;
+  }
+
+  return false;
+}
+
+bool isDependencyOption(const std::string &arg) {
+  return arg == "-MD" || arg == "-MMD" || arg == "-MP" ||
+         startsWith(arg, "-MF") || startsWith(arg, "-MT") ||
+         startsWith(arg, "-MQ");
+}
+
+// The compile command of 'target' turned into one that preprocesses 'arch'
+// to stdout.
+void getPreprocessorCommand(const Target &target, Arch arch,
+                            string_vector &cmd) {
+  string_vector command;
+  bool archAdded = false;
+
+  target.getCommand(command);
+  cmd.clear();
+
+  for (size_t i = 0; i < command.size(); ++i) {
+    const std::string &arg = command[i];
+    const bool hasValue = i && arg[0] == '-' &&
+                          driver::takesSeparateValue(arg.c_str()) &&
+                          i + 1 < command.size();
+
+    if (arg == "-arch" && i + 1 < command.size()) {
+      if (!archAdded) {
+        cmd.push_back(arg);
+        cmd.push_back(getArchName(arch));
+        archAdded = true;
+      }
+
+      ++i;
+      continue;
+    }
+
+    if (arg == "-o" || (i && isDependencyOption(arg))) {
+      if (hasValue)
+        ++i;
+      continue;
+    }
+
+    if (arg == "-c")
+      continue;
+
+    cmd.push_back(arg);
+
+    if (hasValue)
+      cmd.push_back(command[++i]);
+  }
+
+  cmd.push_back("-E");
+}
+
+// Adds the command to the key, apart from the output file: slices write to
+// temporary files.
+void addCommand(std::string &key, const Target &target) {
+  string_vector cmd;
+  std::string stamp;
+
+  getFileStamp(target.compilerpath, stamp);
+  putRecord(key, target.compilerpath);
+  putRecord(key, stamp);
+
+  target.getCommand(cmd);
+
+  for (size_t i = 0; i < cmd.size(); ++i) {
+    if (cmd[i] == "-isysroot" && i + 1 < cmd.size()) {
+      getFileStamp(cmd[i + 1], stamp);
+      putRecord(key, stamp);
+    }
+
+    if (cmd[i] == "-o" && i + 1 < cmd.size())
+      ++i;
+    else
+      putRecord(key, cmd[i]);
+  }
+}
+
+// Preprocesses every architecture of 'targets' in parallel and adds the
+// results to the key. Fails if preprocessing fails or prints diagnostics.
+bool addPreprocessedSources(std::string &key,
+                            const std::vector<const Target *> &targets) {
+  struct Job {
+    pid_t pid;
+    FILE *source;
+    FILE *log;
+  };
+
+  std::vector<Job> jobs;
+  string_vector cmd;
+  bool ok = true;
+
+  for (const Target *target : targets) {
+    for (auto arch : target->targetarchs) {
+      Job job = { -1, tmpfile(), tmpfile() };
+
+      if (job.source && job.log) {
+        getPreprocessorCommand(*target, arch, cmd);
+        job.pid = spawnProcess(target->compilerpath, cmd, fileno(job.source),
+                               fileno(job.log));
+      }
+
+      jobs.push_back(job);
+    }
+  }
+
+  for (auto &job : jobs) {
+    std::string source;
+    struct stat st;
+
+    ok &= !waitProcess(job.pid) && job.log && !fstat(fileno(job.log), &st) &&
+          !st.st_size;
+
+    if (ok) {
+      rewind(job.source);
+      ok = getFDContent(fileno(job.source), source);
+      putRecord(key, hashToString(hashString(source)));
+      putRecord(key, source.size());
+    }
+
+    if (job.source)
+      fclose(job.source);
+
+    if (job.log)
+      fclose(job.log);
+  }
+
+  return ok;
+}
+
+bool prepare(const char *cachedir, const Target &target,
+             const fanout::Plan &plan, Job &job) {
+  trace::Span span("compilecache: key");
+  std::vector<const Target *> targets;
+  char cwd[PATH_MAX + 1];
+
+  if (!driver::getOutputFile(target, job.output) || !getcwd(cwd, sizeof(cwd)))
+    return false;
+
+  for (auto &arg : target.args) {
+    if (isUncacheable(arg))
+      return false;
+  }
+
+  if (plan.slices.empty()) {
+    targets.push_back(&target);
+  } else {
+    for (auto &slice : plan.slices)
+      targets.push_back(&slice.target);
+  }
+
+  putRecord(job.key, std::string(CompileCacheMagic));
+  putRecord(job.key, std::string(target::getOSXCrossVersion()));
+  putRecord(job.key, std::string(cwd));
+
+  string_vector env;
+  cache::getSetupEnvironment(env);
+
+  for (const char *var : CompileEnvVars) {
+    const char *val = getenv(var);
+    env.push_back(val ? std::string(var) + "=" + val : std::string(var));
+  }
+
+  putRecord(job.key, env);
+
+  // The dependency file names the output.
+  if (driver::getDependencyFile(target, job.output, job.depfile))
+    putRecord(job.key, job.output);
+
+  for (const Target *t : targets)
+    addCommand(job.key, *t);
+
+  if (!addPreprocessedSources(job.key, targets))
+    return false;
+
+  std::string hash = hashToString(hashString(job.key));
+
+  job.path = cachedir;
+  job.path += PATHDIV;
+  job.path += hash.substr(0, 2);
+  job.path += PATHDIV;
+  job.path += hash.substr(2);
+
+  return true;
+}
+
+//
+// Statistics: '<cachedir>/stats' holds one '<counter> <value>' line per
+// counter and is updated under an exclusive lock.
+//
+
+class StatsFile {
+public:
+  explicit StatsFile(const char *cachedir) : stats() {
+    std::string path = cachedir;
+    std::string content;
+
+    path += PATHDIV;
+    path += "stats";
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+
+    if (fd != -1 && flock(fd, LOCK_EX)) {
+      close(fd);
+      fd = -1;
+    }
+
+    if (fd == -1 || !getFDContent(fd, content))
+      return;
+
+    for (const char *p = content.c_str(); *p;) {
+      char name[32];
+      unsigned long long value;
+
+      if (sscanf(p, "%31s %llu", name, &value) == 2) {
+        for (int i = 0; i < NumCounters; ++i) {
+          if (!strcmp(name, CounterNames[i]))
+            stats.counters[i] = value;
+        }
+      }
+
+      if (!(p = strchr(p, '\n')))
+        break;
+
+      ++p;
+    }
+  }
+
+  ~StatsFile() {
+    if (fd != -1)
+      close(fd); // releases the lock
+  }
+
+  bool isOpen() const { return fd != -1; }
+
+  bool write() {
+    std::string content;
+
+    for (int i = 0; i < NumCounters; ++i) {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%s %llu\n", CounterNames[i],
+               stats.counters[i]);
+      content += buf;
+    }
+
+    return !lseek(fd, 0, SEEK_SET) && !ftruncate(fd, 0) &&
+           ::write(fd, content.data(), content.size()) ==
+               static_cast<ssize_t>(content.size());
+  }
+
+  Stats stats;
+
+private:
+  StatsFile(const StatsFile &) = delete;
+  StatsFile &operator=(const StatsFile &) = delete;
+
+  int fd;
+};
+
+void count(const char *cachedir, Counter counter,
+           unsigned long long value = 1) {
+  if (!createDirectory(cachedir))
+    return;
+
+  StatsFile file(cachedir);
+
+  if (!file.isOpen())
+    return;
+
+  file.stats.counters[counter] += value;
+  file.write();
+}
+
+// Entries are a sequence of records (see tools::putRecord()): magic, key,
+// object file and dependency file.
+bool restore(const Job &job) {
+  trace::Span span("compilecache: restore");
+  std::string entry;
+  std::string str;
+  std::string object;
+  std::string deps;
+
+  if (!getFileContent(job.path, entry))
+    return false;
+
+  const char *p = entry.c_str();
+  const char *end = p + entry.size();
+
+  if (!getRecord(p, end, str) || str != CompileCacheMagic ||
+      !getRecord(p, end, str) || str != job.key ||
+      !getRecord(p, end, object) || !getRecord(p, end, deps))
+    return false;
+
+  if (!writeFileContentAtomic(job.output, object) ||
+      (!job.depfile.empty() && !writeFileContentAtomic(job.depfile, deps))) {
+    err << "cannot write '" << job.output << "'" << err.endl();
+    return false;
+  }
+
+  // Least recently used entries are evicted first.
+  utimes(job.path.c_str(), nullptr);
+
+  if (debug >= 2)
+    dbg << "compile cache: hit (" << job.path << ")" << dbg.endl();
+
+  return true;
+}
+
+void store(const char *cachedir, const Job &job) {
+  trace::Span span("compilecache: store");
+  std::string object;
+  std::string deps;
+  std::string entry;
+  std::string dir = job.path;
+
+  if (!getFileContent(job.output, object) ||
+      (!job.depfile.empty() && !getFileContent(job.depfile, deps)))
+    return;
+
+  putRecord(entry, std::string(CompileCacheMagic));
+  putRecord(entry, job.key);
+  putRecord(entry, object);
+  putRecord(entry, deps);
+
+  stripFileName(dir);
+
+  if (!createDirectory(dir) || !writeFileContentAtomic(job.path, entry)) {
+    if (debug)
+      dbg << "compile cache: cannot write to '" << cachedir << "'"
+          << dbg.endl();
+    return;
+  }
+
+  unsigned long long limit = getSizeLimit();
+  bool full;
+
+  {
+    StatsFile file(cachedir);
+
+    if (!file.isOpen())
+      return;
+
+    file.stats.counters[Size] += entry.size();
+    full = limit && file.stats.counters[Size] > limit;
+    file.write();
+  }
+
+  if (full) {
+    Stats stats;
+    cleanup(cachedir, limit, stats);
+  }
+}
+
+// Runs the compiler with its diagnostics going through a file, so that
+// they can be told apart from a silent compilation.
+int compile(const Target &target, bool &diagnostics) {
+  string_vector cmd;
+  FILE *log = tmpfile();
+  int rc;
+
+  target.getCommand(cmd, log != nullptr);
+  rc = waitProcess(spawnProcess(target.compilerpath, cmd, -1,
+                                log ? fileno(log) : -1));
+
+  if (!log) {
+    diagnostics = true;
+    return rc;
+  }
+
+  std::string str;
+  rewind(log);
+
+  if (getFDContent(fileno(log), str) && !str.empty()) {
+    errout << str;
+    errout.flush();
+    diagnostics = true;
+  }
+
+  fclose(log);
+  return rc;
+}
+
+struct EntryFile {
+  std::string path;
+  time_t atime; // last use, see restore()
+  unsigned long long size;
+
+  bool operator<(const EntryFile &entry) const { return atime < entry.atime; }
+};
+
+// Collects all entries; removes stale temporary files on the way.
+void listEntries(const char *cachedir, std::vector<EntryFile> &entries) {
+  std::vector<std::string> dirs;
+  time_t now = time(nullptr);
+
+  listFiles(cachedir, &dirs, [](const char *name) {
+    return strlen(name) == 2 && isxdigit(name[0]) && isxdigit(name[1]);
+  });
+
+  for (auto &dir : dirs) {
+    std::vector<std::string> files;
+    std::string dirpath = cachedir;
+
+    dirpath += PATHDIV;
+    dirpath += dir;
+
+    listFiles(dirpath.c_str(), &files, [](const char *name) {
+      return *name != '.';
+    });
+
+    for (auto &file : files) {
+      EntryFile entry;
+      struct stat st;
+
+      entry.path = dirpath + PATHDIV + file;
+
+      if (stat(entry.path.c_str(), &st) || !S_ISREG(st.st_mode))
+        continue;
+
+      if (file.find(".tmp.") != std::string::npos) {
+        if (now - st.st_mtime > StaleTempFileAge)
+          unlink(entry.path.c_str());
+        continue;
+      }
+
+      entry.atime = st.st_mtime;
+      entry.size = st.st_size;
+      entries.push_back(entry);
+    }
+  }
+}
+
+} // anonymous namespace
+
+const char *getCacheDir() {
+  const char *dir = getenv("OSXCROSS_COMPILE_CACHE_DIR");
+  return dir && *dir ? dir : nullptr;
+}
+
+unsigned long long getSizeLimit() {
+  const char *value = getenv("OSXCROSS_COMPILE_CACHE_SIZE");
+  char *end;
+
+  if (!value || !*value)
+    return 5ULL << 30;
+
+  unsigned long long size = strtoull(value, &end, 10);
+
+  switch (*end) {
+  case 'G': case 'g':
+    size <<= 10;
+    // falls through
+  case 'M': case 'm':
+    size <<= 10;
+    // falls through
+  case 'K': case 'k':
+    size <<= 10;
+  }
+
+  return size;
+}
+
+int run(const Target &target, const fanout::Plan &plan) {
+  const char *cachedir = getCacheDir();
+  bool diagnostics = false;
+  Job job;
+  int rc;
+
+  if (!cachedir || target.mode != DriverMode::compile)
+    return -1;
+
+  if (!prepare(cachedir, target, plan, job)) {
+    if (debug >= 2)
+      dbg << "compile cache: uncacheable" << dbg.endl();
+
+    count(cachedir, Uncacheable);
+    return -1;
+  }
+
+  if (restore(job)) {
+    count(cachedir, Hits);
+    return 0;
+  }
+
+  count(cachedir, Misses);
+
+  if (plan.slices.empty())
+    rc = compile(target, diagnostics);
+  else
+    rc = fanout::run(plan, &diagnostics);
+
+  if (!rc && !diagnostics)
+    store(cachedir, job);
+
+  return rc;
+}
+
+bool getStats(const char *cachedir, Stats &stats) {
+  StatsFile file(cachedir);
+  stats = file.stats;
+  return file.isOpen();
+}
+
+bool zeroStats(const char *cachedir) {
+  StatsFile file(cachedir);
+
+  if (!file.isOpen())
+    return false;
+
+  file.stats.counters[Hits] = 0;
+  file.stats.counters[Misses] = 0;
+  file.stats.counters[Uncacheable] = 0;
+  return file.write();
+}
+
+bool cleanup(const char *cachedir, unsigned long long limit, Stats &stats) {
+  trace::Span span("compilecache: cleanup");
+  StatsFile file(cachedir);
+  std::vector<EntryFile> entries;
+  unsigned long long size = 0;
+
+  if (!file.isOpen())
+    return false;
+
+  listEntries(cachedir, entries);
+  std::sort(entries.begin(), entries.end());
+
+  for (auto &entry : entries)
+    size += entry.size;
+
+  // Leave some room, so that not every store has to clean up.
+  size_t evicted = 0;
+
+  if (limit && size > limit) {
+    for (auto &entry : entries) {
+      if (size <= limit / 10 * 9)
+        break;
+
+      if (!unlink(entry.path.c_str()))
+        size -= entry.size;
+
+      ++evicted;
+    }
+  }
+
+  if (debug && evicted)
+    dbg << "compile cache: evicted " << evicted << " entries" << dbg.endl();
+
+  file.stats.counters[Size] = size;
+  file.stats.entries = entries.size() - evicted;
+  stats = file.stats;
+
+  return file.write();
+}
+
+bool clear(const char *cachedir) {
+  StatsFile file(cachedir);
+  std::vector<EntryFile> entries;
+  bool ok = file.isOpen();
+
+  listEntries(cachedir, entries);
+
+  for (auto &entry : entries)
+    ok &= !unlink(entry.path.c_str());
+
+  file.stats.counters[Size] = 0;
+  return file.write() && ok;
+}
+
+} // namespace compilecache
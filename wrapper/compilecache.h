@@ -0,0 +1,83 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace target {
+struct Target;
+}
+
+namespace fanout {
+struct Plan;
+}
+
+namespace compilecache {
+
+using target::Target;
+
+//
+// Compile cache
+//
+// With 'OSXCROSS_COMPILE_CACHE_DIR' (env), the results of compile (-c)
+// invocations are kept in a content-addressed store. Their key covers
+//
+//  - the command the wrapper executes, apart from the output file,
+//  - the working directory,
+//  - the compiler binary and the SDK (file stamps) and
+//  - the preprocessed source of every architecture.
+//
+// Entries hold the object file (universal ones included) and the -MD / -MMD
+// dependency file. Invocations that print diagnostics are not stored; those
+// must be repeated on every invocation.
+//
+// 'OSXCROSS_COMPILE_CACHE_SIZE' (env, K/M/G suffixes, default 5G, 0: no
+// limit) bounds the store; the least recently used entries are evicted
+// first. See osxcross-cache for statistics.
+//
+
+const char *getCacheDir();
+unsigned long long getSizeLimit();
+
+// Serves the invocation from the cache, or runs it (through 'plan' if it
+// has been split per architecture) and stores the result. Returns the exit
+// code, or -1 if the invocation cannot be cached.
+int run(const Target &target, const fanout::Plan &plan);
+
+//
+// Statistics and maintenance
+//
+
+enum Counter { Hits, Misses, Uncacheable, Size, NumCounters };
+
+struct Stats {
+  unsigned long long counters[NumCounters];
+  unsigned long long entries; // counted by cleanup() only
+};
+
+bool getStats(const char *cachedir, Stats &stats);
+bool zeroStats(const char *cachedir);
+
+// Evicts least recently used entries until the store fits into 'limit'
+// (0: only recount). Stale temporary files are removed as well.
+bool cleanup(const char *cachedir, unsigned long long limit, Stats &stats);
+
+// Removes all entries.
+bool clear(const char *cachedir);
+
+} // namespace compilecache
@@ -0,0 +1,971 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * Compiler invocations: option parsing, target detection, setup and
+ * execution of the compiler. Shared by the wrapper binary (main.cpp) and
+ * libosxcross (libosxcross.cpp).
+ */
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <cassert>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "tools.h"
+#include "target.h"
+#include "progs.h"
+#include "cache.h"
+#include "trace.h"
+#include "driver.h"
+#include "fanout.h"
+#include "compilecache.h"
+#include "sdkpch.h"
+
+using namespace tools;
+using namespace target;
+
+int unittest = 0;
+int debug = 0;
+
+namespace driver {
+
+benchmark *bench;
+
+// Set by program::resolveCompiler(): resolve compiler invocations only,
+// never run programs, and reuse setup() results across invocations.
+bool resolveOnly;
+
+bool takesSeparateValue(const char *arg) {
+  constexpr const char *Options[] = {
+    "-o", "-MF", "-MT", "-MQ", "-include", "-imacros", "-iquote",
+    "-idirafter", "-isysroot", "-include-pch", "-target", "-framework",
+    "-Xlinker", "-Xclang", "-Xassembler", "-Xpreprocessor", "-install_name",
+    "-rpath",
+    // forwarded by commandopts::parser
+    "-x", "-I", "-isystem", "-cxx-isystem", "-icxx-isystem"
+  };
+
+  for (const char *opt : Options) {
+    if (!strcmp(arg, opt))
+      return true;
+  }
+
+  return false;
+}
+
+bool getOutputFile(const Target &target, std::string &output) {
+  const string_vector &args = target.args;
+  const char *input = nullptr;
+  size_t inputs = 0;
+
+  output.clear();
+
+  if (target.mode != DriverMode::compile && target.mode != DriverMode::link)
+    return false;
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    const char *arg = args[i].c_str();
+
+    if (*arg != '-' || !arg[1]) {
+      input = arg;
+      ++inputs;
+    } else if (!strcmp(arg, "-o") && i + 1 < args.size()) {
+      output = args[++i];
+    } else if (!strncmp(arg, "-o", 2)) {
+      return false; // -o<file> or an unknown option
+    } else if (takesSeparateValue(arg)) {
+      ++i;
+    }
+  }
+
+  // clang writes one object file per source with -c.
+  if (!inputs || (target.mode == DriverMode::compile && inputs > 1))
+    return false;
+
+  if (output.empty()) {
+    if (target.mode == DriverMode::link) {
+      output = "a.out";
+    } else if (strcmp(input, "-")) {
+      output = getFileName(input);
+      stripFileExtension(output);
+      output += ".o";
+    }
+  }
+
+  return !output.empty() && output != "-";
+}
+
+bool getDependencyFile(const Target &target, const std::string &output,
+                       std::string &depfile) {
+  const string_vector &args = target.args;
+  bool requested = false;
+
+  depfile.clear();
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    const char *arg = args[i].c_str();
+
+    if (!strcmp(arg, "-MD") || !strcmp(arg, "-MMD"))
+      requested = true;
+    else if (!strcmp(arg, "-MF") && i + 1 < args.size())
+      depfile = args[++i];
+    else if (!strncmp(arg, "-MF", 3))
+      depfile = arg + 3;
+    else if (*arg == '-' && takesSeparateValue(arg))
+      ++i;
+  }
+
+  if (!requested) {
+    depfile.clear();
+    return false;
+  }
+
+  if (depfile.empty()) {
+    depfile = output;
+    stripFileExtension(depfile);
+    depfile += ".d";
+  }
+
+  return true;
+}
+
+namespace {
+
+std::map<std::string, std::string> resolvedSetups;
+
+// Per-architecture slices of a universal invocation, see fanout.h.
+fanout::Plan plan;
+
+bool runProgram(const program::prog &prog, int argc, char **argv,
+                Target &target);
+
+void warnExtension(const char *extension) {
+  static bool noextwarnings = !!getenv("OSXCROSS_NO_EXTENSION_WARNINGS");
+  if (noextwarnings)
+    return;
+  warn << extension << " is an osxcross extension" << warn.endl();
+  warninfo << "you can silence this warning via "
+           << "'OSXCROSS_NO_EXTENSION_WARNINGS=1' (env)" << warninfo.endl();
+}
+
+__attribute__((unused))
+void warnDeprecated(const char *flag, const char *replacement = nullptr) {
+  if (replacement)
+    warn << flag << " is deprecated; "
+         << "please use " << replacement << " instead"
+         << warn.endl();
+  else
+    warn << flag << " is deprecated and will be "
+         << "removed soon" << warn.endl();
+}
+
+//
+// Command Line Options
+//
+
+namespace commandopts {
+
+typedef bool (*optFun)(Target &target, const char *opt, const char *val,
+                      char **);
+
+bool versionmin(Target &target, const char *, const char *val, char **) {
+  target.OSNum = parseOSVersion(val);
+
+  if (target.OSNum != val)
+    warn << "'-mmacosx-version-min=' (" << target.OSNum.Str()
+         << " != " << val << ")" << warn.endl();
+
+  return true;
+}
+
+bool arch(Target &target, const char *opt, const char *val, char **) {
+  Arch arch;
+
+  if (!strcmp(opt, "-arch")) {
+    arch = parseArch(val);
+
+    if (arch == Arch::unknown)
+      warn << "'-arch': unknown architecture '" << val << "'"
+           << warn.endl();
+
+    const char *name = getArchName(arch);
+
+    if (strcmp(val, name))
+      warn << "'-arch': '" << val << "' != '" << name << "'" << warn.endl();
+  } else {
+    if (!strcmp(opt, "-m16") || !strcmp(opt, "-mx32")) {
+      err << "'" << opt << "' is not supported" << err.endl();
+      return false;
+    } else if (!strcmp(opt, "-m32")) {
+      arch = Arch::i386;
+    } else if (!strcmp(opt, "-m64")) {
+      arch = Arch::x86_64;
+    } else {
+      __builtin_unreachable();
+    }
+  }
+
+  if (target.isClang())
+    target.addArch(arch);
+  else
+    target.arch = arch;
+
+  return true;
+}
+
+bool stdlib(Target &target, const char *, const char *val, char **) {
+  if (target.isGCC())
+    warnExtension("'-stdlib='");
+
+  size_t i = 0;
+
+  for (auto stdlibname : StdLibNames) {
+    if (!strcmp(val, stdlibname)) {
+      target.stdlib = static_cast<StdLib>(i);
+      break;
+    }
+    ++i;
+  }
+
+  if (i == (sizeof(StdLibNames) / sizeof(StdLibNames[0]))) {
+    err << "value of '-stdlib=' must be ";
+
+    for (size_t j = 0; j < i; ++j) {
+      err << "'" << StdLibNames[j] << "'";
+
+      if (j == i - 2)
+        err << " or ";
+      else if (j < i - 2)
+        err << ", ";
+    }
+
+    err << err.endl();
+    return false;
+  }
+
+  return true;
+}
+
+bool language(Target &target, const char *, const char *val, char **) {
+  target.language = val;
+  return true;
+}
+
+bool usegcclibstdcxx(Target &target, const char *, const char *, char **) {
+  target.stdlib = StdLib::libstdcxx;
+  target.usegcclibs = true;
+  return true;
+}
+
+bool sdkpch(Target &target, const char *, const char *, char **) {
+  target.sdkpch = true;
+  return true;
+}
+
+bool compilerpath(Target &target, const char *, const char *path, char **) {
+  target.compilerpath = path;
+  return true;
+}
+
+bool intrinsicpath(Target &target, const char *, const char *path, char **) {
+  target.intrinsicpath = path;
+  return true;
+}
+
+bool runprog(Target &target, const char *, const char *progname, char **cargs) {
+  auto *prog = program::getprog(progname);
+
+  if (!prog) {
+    err << "'-foc-run-prog': unknown program '" << progname << "'"
+        << err.endl();
+    return false;
+  }
+
+  std::vector<char *> args;
+  args.push_back(const_cast<char *>(progname));
+
+  while (*cargs)
+    args.push_back(*cargs++);
+  args.push_back(nullptr);
+
+  return runProgram(*prog, args.size() - 1, args.data(), target);
+}
+
+bool liblto(Target &target, const char *opt, const char *, char **) {
+  target.wliblto = !strcmp(opt, "-Wliblto");
+  return true;
+}
+
+bool checkincludepath(Target &, const char *opt, const char *path, char **) {
+#ifndef __APPLE__
+  constexpr const char *DangerousIncludePaths[] = { "/usr/include",
+                                                    "/usr/local/include" };
+
+  static bool noinccheck = !!getenv("OSXCROSS_NO_INCLUDE_PATH_WARNINGS");
+
+  if (noinccheck)
+    return true;
+
+  trace::Probe probe("realpath", path);
+  char *resolved = realpath(path, nullptr);
+  probe(resolved != nullptr);
+  const char *rpath = resolved ? resolved : path;
+
+  for (const char *dpath : DangerousIncludePaths) {
+    if (!strncmp(rpath, dpath, strlen(dpath))) {
+      warn << "possibly dangerous include path specified: '" << opt << " "
+           << path << "'";
+
+      if (strcmp(path, rpath))
+        warn << " (" << rpath << ")";
+
+      warn << warn.endl();
+
+      warninfo << "you can silence this warning via "
+               << "'OSXCROSS_NO_INCLUDE_PATH_WARNINGS=1' (env)"
+               << warninfo.endl();
+    }
+  }
+
+  free(resolved);
+#else
+  (void)opt;
+  (void)path;
+#endif
+
+  return true;
+}
+
+typedef OptParser<optFun, 20> Parser;
+typedef Parser::ValueMode ValueMode;
+typedef Parser::Forwarding Forwarding;
+
+const Parser parser = {{
+  {"-mmacos-version-min", versionmin, ValueMode::joinedWithEquals},
+  {"-mmacosx-version-min", versionmin, ValueMode::joinedWithEquals},
+  {"-stdlib", stdlib, ValueMode::joinedWithEquals},
+  {"-arch", arch, ValueMode::separate},
+  {"-m16", arch},
+  {"-m32", arch},
+  {"-mx32", arch},
+  {"-m64", arch},
+  {"-x", language, ValueMode::joinedOrSeparate, Forwarding::keep},
+  {"-foc-use-gcc-libstdc++", usegcclibstdcxx},
+  {"-foc-sdk-pch", sdkpch},
+  // for internal use only
+  {"-foc-run-prog", runprog, ValueMode::joinedWithEquals},
+  {"-Wliblto", liblto, ValueMode::none, Forwarding::keep},
+  {"-Wno-liblto", liblto, ValueMode::none, Forwarding::keep},
+  {"-isystem", checkincludepath, ValueMode::joinedOrSeparate,
+   Forwarding::keep},
+  {"-icxx-isystem", checkincludepath, ValueMode::joinedOrSeparate,
+   Forwarding::keep},
+  {"-cxx-isystem", checkincludepath, ValueMode::joinedOrSeparate,
+   Forwarding::keep},
+  {"-I", checkincludepath, ValueMode::joinedOrSeparate, Forwarding::keep},
+
+  // sets a custom path for the compiler
+  {"-foc-compiler-path", compilerpath, ValueMode::joinedWithEquals},
+
+  // specifies an additional directory to search when looking for clang's
+  // intrinsic paths
+  {"-foc-intrinsic-path", intrinsicpath, ValueMode::joinedWithEquals}
+}, []() {
+  const char *value = getenv("OCDEBUG");
+  return value && atoi(value) != 0;
+}()};
+
+//
+// Classifies the arguments the parser does not handle itself in the same
+// pass, so setup() knows what the invocation is going to do.
+//
+
+struct ModeClassifier {
+  DriverMode mode = DriverMode::link;
+  bool skipValue = false;
+  bool infoRequested = false;
+  size_t inputs = 0;
+  size_t sources = 0;
+
+  static bool isObjectFile(const char *arg) {
+    constexpr const char *ObjectExtensions[] = { ".o", ".a", ".so", ".dylib",
+                                                 ".tbd", ".obj", ".lo" };
+    const char *ext = strrchr(arg, '.');
+
+    if (!ext || strchr(ext, '/'))
+      return false;
+
+    for (const char *objext : ObjectExtensions) {
+      if (!strcmp(ext, objext))
+        return true;
+    }
+
+    return false;
+  }
+
+  void setMode(DriverMode phase) {
+    if (phase < mode)
+      mode = phase;
+  }
+
+  void add(const char *arg) {
+    if (skipValue) {
+      skipValue = false;
+      return;
+    }
+
+    if (*arg != '-' || !arg[1]) {
+      ++inputs;
+      if (*arg == '-' || !isObjectFile(arg))
+        ++sources;
+      return;
+    }
+
+    if (!strcmp(arg, "-c"))
+      setMode(DriverMode::compile);
+    else if (!strcmp(arg, "-S"))
+      setMode(DriverMode::assemble);
+    else if (!strcmp(arg, "-E"))
+      setMode(DriverMode::preprocess);
+    else if (!strcmp(arg, "-fsyntax-only"))
+      setMode(DriverMode::syntaxOnly);
+    else if (!strcmp(arg, "--version") || !strcmp(arg, "-v") ||
+             !strcmp(arg, "-dumpversion") || !strcmp(arg, "-dumpmachine") ||
+             !strcmp(arg, "--help"))
+      infoRequested = true;
+    else
+      skipValue = takesSeparateValue(arg);
+  }
+
+  void finish(int argc, Target &target) {
+    if (!inputs && (infoRequested || argc <= 1))
+      mode = DriverMode::info;
+
+    target.mode = mode;
+    target.objectInputsOnly = mode == DriverMode::link && inputs &&
+                              !sources && !target.language;
+  }
+};
+
+bool parse(int argc, char **argv, Target &target) {
+  trace::Span span("commandopts::parse");
+  ModeClassifier classifier;
+
+  target.args.reserve(argc);
+
+  if (char *p = getenv("MACOSX_DEPLOYMENT_TARGET")) {
+    target.OSNum = parseOSVersion(p);
+    unsetenv("MACOSX_DEPLOYMENT_TARGET");
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    char *arg = argv[i];
+
+    if (*arg != '-') {
+      target.args.push_back(arg);
+      classifier.add(arg);
+      continue;
+    }
+
+    const Parser::Option *opt = parser.parse(arg);
+
+    if (!opt) {
+      target.args.push_back(arg);
+      classifier.add(arg);
+      continue;
+    }
+
+    const bool pusharg = opt->forwarding == Forwarding::keep;
+    const int firstArg = i;
+    const char *val = nullptr;
+
+    if (opt->valueMode != ValueMode::none) {
+      val = arg + opt->namelen;
+
+      if (opt->valueMode == ValueMode::joinedWithEquals) {
+        if (*val != '=') {
+          err << "expected '" << opt->name << "=<val>' "
+              << "instead of '" << arg << "'" << err.endl();
+          return false;
+        }
+
+        ++val;
+      }
+
+      if (opt->valueMode != ValueMode::joinedWithEquals &&
+          !*val && i < argc - 1)
+        val = argv[++i];
+
+      if (!*val) {
+        err << "missing argument for '" << opt->name << "'" << err.endl();
+        return false;
+      }
+    }
+
+    parser.printDebug(*opt, arg, val);
+
+    if (opt->fun && !opt->fun(target, opt->name, val, &argv[i + 1]))
+      return false;
+
+    if (pusharg) {
+      for (int j = firstArg; j <= i; ++j)
+        target.args.push_back(argv[j]);
+    }
+  }
+
+  classifier.finish(argc, target);
+  return true;
+}
+
+} // namespace commandopts
+
+void detectCXXLib(Target &target) {
+  if (target.compilername.size() <= 7)
+    return;
+
+  StdLib prevstdlib = target.stdlib;
+
+  if (endsWith(target.compilername, "-stdc++")) {
+    target.stdlib = StdLib::libstdcxx;
+    target.compilername.resize(target.compilername.size() - 7);
+  } else if (endsWith(target.compilername, "-gstdc++")) {
+    target.stdlib = StdLib::libstdcxx;
+    target.usegcclibs = true;
+    target.compilername.resize(target.compilername.size() - 8);
+  } else if (endsWith(target.compilername, "-libc++")) {
+    target.stdlib = StdLib::libcxx;
+    target.compilername.resize(target.compilername.size() - 7);
+  }
+
+  if (prevstdlib != StdLib::unset && prevstdlib != target.stdlib)
+    warn << "ignoring '-stdlib=" << getStdLibString(prevstdlib) << "'"
+         << warn.endl();
+}
+
+//
+// setupTarget():
+//  run Target::setup() or reuse its result from the setup cache
+//
+
+bool setupTarget(Target &target) {
+  trace::Span span("setupTarget");
+  const char *cachedir = cache::getSetupCacheDir();
+
+  if (!cachedir && !resolveOnly)
+    return target.setup();
+
+  std::string key;
+  cache::getSetupKey(target, key);
+
+  if (resolveOnly) {
+    auto it = resolvedSetups.find(key);
+
+    if (it != resolvedSetups.end() &&
+        cache::loadSetupEntry(it->second, key, target))
+      return true;
+  }
+
+  if (cachedir && cache::loadSetup(cachedir, key, target))
+    return true;
+
+  size_t numargs = target.args.size();
+  unsigned long printed = Message::printed;
+
+  if (!target.setup())
+    return false;
+
+  // Do not cache results that come with diagnostics; those must be
+  // repeated on every invocation.
+  if (Message::printed == printed) {
+    std::string entry;
+    cache::getSetupEntry(key, target, numargs, entry);
+
+    if (cachedir)
+      cache::storeSetup(cachedir, key, entry);
+
+    if (resolveOnly)
+      resolvedSetups[key].swap(entry);
+  }
+
+  return true;
+}
+
+//
+// setupTargets():
+//  universal invocations may be split into one compiler process per
+//  architecture; those are set up one by one
+//
+
+bool setupTargets(Target &target) {
+  if (resolveOnly || !fanout::split(target, plan))
+    return setupTarget(target);
+
+  for (auto &slice : plan.slices) {
+    if (!setupTarget(slice.target))
+      return false;
+  }
+
+  return true;
+}
+
+//
+// runProgram():
+//  only returns (false) when resolving. Programs started by a
+//  compiler invocation (ld, as, lipo, ...) take over its resolved target;
+//  nested compiler invocations resolve their own.
+//
+
+bool runProgram(const program::prog &prog, int argc, char **argv,
+                Target &target) {
+  if (resolveOnly) {
+    err << "'" << prog.name << "' is not a compiler" << err.endl();
+    return false;
+  }
+
+  target.loadHandoff();
+  prog(argc, argv, target);
+}
+
+} // anonymous namespace
+
+//
+// detectTarget():
+//  detect target and setup invocation command
+//
+
+bool detectTarget(int argc, char **argv, Target &target) {
+  trace::Span span("detectTarget");
+  const char *cmd = argv[0];
+  const char *p = strrchr(cmd, '/');
+  char archName[16];
+  size_t len;
+
+  if (p)
+    cmd = &p[1];
+
+  if (auto *prog = program::getprog(cmd))
+    return runProgram(*prog, argc, argv, target);
+
+  // -> x86_64 <- -apple-darwin13
+  p = strchr(cmd, '-');
+  len = (p ? p : cmd) - cmd;
+
+  if (len >= sizeof(archName))
+    return false;
+
+  memcpy(archName, cmd, len);
+  archName[len] = '\0';
+
+  target.arch = parseArch(archName);
+
+  if (target.arch != Arch::unknown) {
+    cmd += len;
+
+    if (*cmd++ != '-')
+      return false;
+
+    if (strncmp(cmd, "apple-", 6))
+      return false;
+
+    cmd += 6;
+
+    if (strncmp(cmd, "darwin", 6))
+      return false;
+
+    if (!(p = strchr(cmd, '-')))
+      return false;
+
+    target.target = std::string(cmd, p - cmd);
+    target.compiler = getCompilerIdentifier(&p[1]);
+    target.compilername = &p[1];
+
+    if (target.compilername == "cc") {
+      target.compiler = getDefaultCompilerIdentifier();
+      target.compilername = getDefaultCompilerName();
+    } else if (target.compilername == "c++") {
+      target.compiler = getDefaultCXXCompilerIdentifier();
+      target.compilername = getDefaultCXXCompilerName();
+    } else if (auto *prog = program::getprog(target.compilername)) {
+      return runProgram(*prog, argc, argv, target);
+    }
+
+    if (target.target != getDefaultTarget())
+      warn << "this wrapper was built for target "
+            << "'" << getDefaultTarget() << "'" << warn.endl();
+
+    if (!commandopts::parse(argc, argv, target))
+      return false;
+
+    detectCXXLib(target);
+    return setupTargets(target);
+  }
+
+  if (!strncmp(cmd, "o32", 3))
+    target.arch = Arch::i386;
+  else if (!strncmp(cmd, "o64h", 4))
+    target.arch = Arch::x86_64h;
+  else if (!strncmp(cmd, "o64", 3))
+    target.arch = Arch::x86_64;
+  else if (!strncmp(cmd, "oa64e", 5))
+    target.arch = Arch::arm64e;
+  else if (!strncmp(cmd, "oa64", 4))
+    target.arch = Arch::arm64;
+  else
+    return false;
+
+  if (const char *p = strchr(cmd, '-')) {
+    const char *compilername = &cmd[p - cmd + 1];
+    target.compiler = getCompilerIdentifier(compilername);
+    target.compilername = compilername;
+  }
+
+  if (!commandopts::parse(argc, argv, target))
+    return false;
+
+  detectCXXLib(target);
+  return setupTargets(target);
+}
+
+void forgetResolved() { resolvedSetups.clear(); }
+
+//
+// execAlias():
+//  pure aliases (see program::prog::getTool()) do not need any Target
+//  state, execute them before it is built
+//
+
+void execAlias(int argc, char **argv) {
+  const char *cmd = argv[0];
+  const char *p = strrchr(cmd, '/');
+
+  if (p)
+    cmd = &p[1];
+
+  const program::prog *prog = program::getprog(cmd);
+
+  // x86_64-apple-darwin13-nm
+  if (!prog && (p = strstr(cmd, "-apple-darwin")) &&
+      parseArch(std::string(cmd, p - cmd).c_str()) != Arch::unknown &&
+      (p = strchr(p + 13, '-')))
+    prog = program::getprog(p + 1);
+
+  if (prog && prog->getTool())
+    exit(program::executeExternalTool(prog->getTool(), argc, argv));
+}
+
+//
+// run():
+//  resolve the compiler invocation and execute it
+//
+
+int run(int argc, char **argv, Target &target) {
+  char **cargs = nullptr;
+  int rc = -1;
+
+  if (!detectTarget(argc, argv, target)) {
+    err << "while detecting target" << err.endl();
+    return 1;
+  }
+
+  if (target.mode == DriverMode::compile && sdkpch::getCacheDir(target)) {
+    if (plan.slices.empty()) {
+      sdkpch::apply(target, unittest == 2);
+    } else {
+      for (auto &slice : plan.slices)
+        sdkpch::apply(slice.target, unittest == 2);
+    }
+  }
+
+  const Target &primary = plan.slices.empty() ? target
+                                              : plan.slices.front().target;
+
+  if (debug) {
+    bench->halt();
+
+    if (debug >= 2) {
+      dbg << "detected target triple: " << primary.getTriple() << dbg.endl();
+      dbg << "detected compiler: " << primary.compilername << dbg.endl();
+
+      dbg << "detected stdlib: " << getStdLibString(primary.stdlib)
+          << dbg.endl();
+
+      bench->resume();
+    }
+  }
+
+#ifdef __DragonFly__
+  // Escape DragonFlyBSD's weird PFS paths.
+  std::string escapedexecpath;
+  escapePath(target.execpath, escapedexecpath);
+  concatEnvVariable("COMPILER_PATH", escapedexecpath);
+#else
+  concatEnvVariable("COMPILER_PATH", target.execpath);
+#endif
+
+  auto printInput = [&]() {
+    std::string in;
+
+    for (int i = 0; i < argc; ++i) {
+      in += argv[i];
+      in += " ";
+    }
+
+    if (!unittest)
+      dbg << "--> " << in << dbg.endl();
+  };
+
+  auto printOutput = [&](const Target &target) {
+    std::string out;
+
+    out += target.compilerpath;
+
+    if (target.compilerpath != target.fargs[0]) {
+      out += " (";
+      out += target.fargs[0];
+      out += ") ";
+    } else {
+      out += " ";
+    }
+
+    for (size_t i = 1; i < target.fargs.size(); ++i) {
+      out += target.fargs[i];
+      out += " ";
+    }
+
+    for (auto &arg : target.args) {
+      out += arg;
+      out += " ";
+    }
+
+    dbg << "<-- " << out << dbg.endl();
+  };
+
+  auto printCommand = [&]() {
+    printInput();
+    printOutput(target);
+  };
+
+  if (!plan.slices.empty()) {
+    if (debug) {
+      time_type diff = bench->getDiff();
+      string_vector merge;
+      std::string out;
+
+      printInput();
+
+      for (auto &slice : plan.slices)
+        printOutput(slice.target);
+
+      fanout::getMergeCommand(plan, merge);
+
+      for (auto &arg : merge) {
+        out += arg;
+        out += " ";
+      }
+
+      dbg << "<-- " << out << dbg.endl();
+      dbg << "=== time spent in wrapper: " << diff / 1000000.0 << " ms"
+          << dbg.endl();
+    }
+
+    if (unittest == 2)
+      return 0;
+
+    if ((rc = compilecache::run(target, plan)) == -1)
+      rc = fanout::run(plan);
+
+    trace::write();
+    return rc;
+  }
+
+  if (rc == -1) {
+    cargs = new char *[target.fargs.size() + target.args.size() + 1];
+    size_t i = 0;
+
+    for (auto &arg : target.fargs)
+      cargs[i++] = const_cast<char *>(arg.c_str());
+
+    for (auto &arg : target.args)
+      cargs[i++] = const_cast<char *>(arg.c_str());
+
+    cargs[i] = nullptr;
+  }
+
+  if (debug) {
+    time_type diff = bench->getDiff();
+
+    if (rc == -1)
+      printCommand();
+
+    dbg << "=== time spent in wrapper: " << diff / 1000000.0 << " ms"
+        << dbg.endl();
+  }
+
+  if (unittest == 2)
+    return 0;
+
+  if (rc == -1 && (rc = compilecache::run(target, plan)) != -1) {
+    trace::write();
+    return rc;
+  }
+
+  if (rc == -1)
+    trace::exec(target.compilerpath.c_str());
+
+  if (rc == -1 && execvp(target.compilerpath.c_str(), cargs)) {
+    err << "invoking compiler failed" << err.endl();
+
+    if (!debug)
+      printCommand();
+
+    return 1;
+  }
+
+  return rc;
+}
+
+} // namespace driver
+
+namespace program {
+
+int executeCompiler(int argc, char **argv) {
+  trace::Span span("Target::Target");
+  Target target;
+  span.end();
+
+  return driver::run(argc, argv, target);
+}
+
+bool resolveCompiler(int argc, char **argv, Target &target) {
+  driver::resolveOnly = true;
+  return driver::detectTarget(argc, argv, target);
+}
+
+} // namespace program
@@ -0,0 +1,68 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace target {
+struct Target;
+}
+
+namespace driver {
+
+using target::Target;
+
+//
+// Compiler invocations
+//
+// The wrapper binary (main.cpp) runs execAlias() and run(); libosxcross
+// and osxcross-resolve only resolve invocations (see
+// program::resolveCompiler()).
+//
+
+// Measures the time spent in the wrapper (OCDEBUG); set by main().
+extern tools::benchmark *bench;
+
+// Set while resolving only; programs are rejected instead of being run.
+extern bool resolveOnly;
+
+// Drops the setup() results kept in memory while resolving only.
+void forgetResolved();
+
+// Options whose value is the next argument (-o <file>, -MF <file>, ...).
+bool takesSeparateValue(const char *arg);
+
+// The file a compile or link invocation writes: its '-o' or the default
+// the compiler picks. False if there is no single output file.
+bool getOutputFile(const Target &target, std::string &output);
+
+// The dependency file -MD / -MMD write along with 'output', if requested.
+bool getDependencyFile(const Target &target, const std::string &output,
+                       std::string &depfile);
+
+// Pure tool aliases (x86_64-apple-darwinXX-nm, ...) are executed right
+// away. Only returns if argv[0] is not one.
+void execAlias(int argc, char **argv);
+
+// Fills in target.fargs, target.args and target.compilerpath.
+bool detectTarget(int argc, char **argv, Target &target);
+
+// Resolves the invocation and executes the compiler.
+int run(int argc, char **argv, Target &target);
+
+} // namespace driver
@@ -0,0 +1,289 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <unistd.h>
+
+#include "tools.h"
+#include "target.h"
+#include "trace.h"
+#include "driver.h"
+#include "fanout.h"
+
+namespace fanout {
+
+using namespace tools;
+using target::DriverMode;
+
+bool enabled() {
+  const char *value = getenv("OSXCROSS_PARALLEL_ARCHS");
+  return value && atoi(value) > 0;
+}
+
+namespace {
+
+bool startsWith(const char *str, const char *prefix) {
+  return !strncmp(str, prefix, strlen(prefix));
+}
+
+// Options that ask for a dependency file as a side effect of compiling.
+bool isDependencyOption(const char *arg) {
+  return !strcmp(arg, "-MD") || !strcmp(arg, "-MMD") || !strcmp(arg, "-MP") ||
+         startsWith(arg, "-MF") || startsWith(arg, "-MT") ||
+         startsWith(arg, "-MQ");
+}
+
+// Whether clang runs dsymutil on the output of a link: the last -g
+// option is not -g0 and sources are compiled in the same invocation.
+bool wantsDSYM(const Target &target) {
+  const char *last = nullptr;
+
+  if (target.mode != DriverMode::link || target.objectInputsOnly)
+    return false;
+
+  for (auto &arg : target.args) {
+    const char *opt = arg.c_str();
+
+    if (!strcmp(opt, "-g") || (!strncmp(opt, "-g", 2) && isdigit(opt[2])) ||
+        startsWith(opt, "-ggdb") || startsWith(opt, "-glldb") ||
+        startsWith(opt, "-gdwarf") || startsWith(opt, "-gline-"))
+      last = opt;
+  }
+
+  return last && strcmp(last, "-g0");
+}
+
+} // anonymous namespace
+
+bool split(const Target &target, Plan &plan) {
+  if (!target.isClang() || target.targetarchs.size() < 2)
+    return false;
+
+  // GCC's libstdc++ installations are per architecture.
+  if (!enabled() && !target.usegcclibs)
+    return false;
+
+  if (target.mode != DriverMode::compile && target.mode != DriverMode::link)
+    return false;
+
+  const string_vector &args = target.args;
+  std::string output;
+  std::string depfile;
+  bool depfileGiven = false;
+  bool deptarget = false;
+  bool dylib = false;
+  bool installName = false;
+
+  if (!driver::getOutputFile(target, output))
+    return false;
+
+  // The dSYM would be named after the temporary output of the slice, and
+  // the object files it is built from are gone once the slice exits.
+  if (wantsDSYM(target))
+    return false;
+
+  for (auto &arg : args) {
+    // Intermediate files are named after the input, which all slices share.
+    if (startsWith(arg.c_str(), "-save-temps") ||
+        startsWith(arg.c_str(), "--serialize-diagnostics"))
+      return false;
+
+    dylib |= arg == "-dynamiclib" || arg == "-shared";
+    installName |= arg.find("install_name") != std::string::npos;
+    depfileGiven |= startsWith(arg.c_str(), "-MF");
+    deptarget |= startsWith(arg.c_str(), "-MT") ||
+                 startsWith(arg.c_str(), "-MQ");
+  }
+
+  const bool deps = driver::getDependencyFile(target, output, depfile);
+
+  plan.output = output;
+  plan.slices.clear();
+  plan.slices.reserve(target.targetarchs.size());
+
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%ld.tmp", static_cast<long>(getpid()));
+
+  for (auto arch : target.targetarchs) {
+    const bool first = plan.slices.empty();
+
+    plan.slices.push_back(Slice());
+    Slice &slice = plan.slices.back();
+
+    slice.target = target;
+    slice.target.targetarchs.assign(1, arch);
+    slice.output = output + "." + getArchName(arch) + suffix;
+
+    string_vector &sargs = slice.target.args;
+    bool haveOutput = false;
+
+    sargs.clear();
+    sargs.reserve(args.size() + 5);
+
+    for (size_t i = 0; i < args.size(); ++i) {
+      const char *arg = args[i].c_str();
+
+      if (!strcmp(arg, "-o")) {
+        sargs.push_back(arg);
+        sargs.push_back(slice.output);
+        haveOutput = true;
+        ++i;
+        continue;
+      }
+
+      const bool skipValue = *arg == '-' && driver::takesSeparateValue(arg);
+
+      // The first slice writes the dependency file.
+      if (!first && *arg == '-' && isDependencyOption(arg)) {
+        if (skipValue)
+          ++i;
+        continue;
+      }
+
+      sargs.push_back(args[i]);
+
+      if (skipValue && i + 1 < args.size())
+        sargs.push_back(args[++i]);
+    }
+
+    if (!haveOutput) {
+      sargs.push_back("-o");
+      sargs.push_back(slice.output);
+    }
+
+    // The linker names a dylib after its '-o' by default.
+    if (dylib && !installName) {
+      sargs.push_back("-install_name");
+      sargs.push_back(output);
+    }
+
+    // clang derives the dependency file name and its target from '-o'.
+    if (first && deps) {
+      if (!depfileGiven) {
+        sargs.push_back("-MF");
+        sargs.push_back(depfile);
+      }
+
+      if (!deptarget) {
+        sargs.push_back("-MQ");
+        sargs.push_back(output);
+      }
+    }
+  }
+
+  return true;
+}
+
+void getMergeCommand(const Plan &plan, string_vector &cmd) {
+  const Target &target = plan.slices.front().target;
+
+  cmd.clear();
+  cmd.push_back(std::string(target.execpath) + "/" + target.getTriple() +
+                "-lipo");
+  cmd.push_back("-create");
+
+  for (auto &slice : plan.slices)
+    cmd.push_back(slice.output);
+
+  cmd.push_back("-output");
+  cmd.push_back(plan.output);
+}
+
+int run(const Plan &plan, bool *diagnostics) {
+  struct Job {
+    pid_t pid;
+    FILE *log;
+  };
+
+  trace::Span span("fanout: slices");
+  std::vector<Job> jobs;
+  string_vector cmd;
+  int rc = 0;
+
+  jobs.reserve(plan.slices.size());
+
+  for (auto &slice : plan.slices) {
+    const Target &target = slice.target;
+    Job job;
+
+    // Slices print their diagnostics in -arch order.
+    if (!(job.log = tmpfile()))
+      err << "cannot create temporary file" << err.endl();
+
+    // The slices were set up one after another in this process, so the
+    // variables setup() exports (OSXCROSS_RESOLVED_TARGET, ...) are those
+    // of the last one. Each slice gets its own.
+    for (size_t i = 0; i < target.environment.size(); i += 2)
+      setenv(target.environment[i].c_str(),
+             target.environment[i + 1].c_str(), 1);
+
+    target.getCommand(cmd, job.log != nullptr);
+    job.pid = spawnProcess(target.compilerpath, cmd, -1,
+                           job.log ? fileno(job.log) : -1);
+    jobs.push_back(job);
+  }
+
+  for (auto &job : jobs) {
+    int status = waitProcess(job.pid);
+
+    if (status && !rc)
+      rc = status;
+
+    if (job.log) {
+      std::string log;
+
+      rewind(job.log);
+
+      if (getFDContent(fileno(job.log), log) && !log.empty()) {
+        errout << log;
+
+        if (diagnostics)
+          *diagnostics = true;
+      }
+
+      fclose(job.log);
+    }
+  }
+
+  errout.flush();
+  span.end();
+
+  if (!rc) {
+    trace::Span mergeSpan("fanout: lipo");
+    getMergeCommand(plan, cmd);
+    rc = waitProcess(spawnProcess(cmd[0], cmd));
+  }
+
+  for (auto &slice : plan.slices)
+    unlink(slice.output.c_str());
+
+  return rc;
+}
+
+} // namespace fanout
@@ -0,0 +1,66 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace fanout {
+
+using target::Target;
+using tools::string_vector;
+
+//
+// Parallel universal builds
+//
+// With 'OSXCROSS_PARALLEL_ARCHS=1' (env), a clang invocation that compiles
+// or links for more than one architecture (-arch x86_64 -arch arm64) is
+// split into one compiler process per architecture. The slices run
+// concurrently, write to temporary files next to the output and are merged
+// with lipo afterwards.
+//
+// clang++-gstdc++ is always split this way: it uses one GCC libstdc++
+// installation per architecture.
+//
+// Diagnostics of the slices are printed in -arch order once all of them
+// have finished. The exit code is the one of the first failing slice.
+//
+
+struct Slice {
+  Target target;
+  std::string output; // temporary, per-architecture output
+};
+
+struct Plan {
+  std::string output; // the universal binary
+  std::vector<Slice> slices;
+};
+
+bool enabled();
+
+// Splits 'target' (before setup()) into one slice per architecture. Returns
+// false for invocations that have to go to the compiler as a whole.
+bool split(const Target &target, Plan &plan);
+
+// lipo -create <slices> -output <output>; slices must be set up.
+void getMergeCommand(const Plan &plan, string_vector &cmd);
+
+// Runs the slices and merges them; returns the exit code. Sets
+// '*diagnostics' if a slice printed any.
+int run(const Plan &plan, bool *diagnostics = nullptr);
+
+} // namespace fanout
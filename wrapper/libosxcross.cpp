@@ -0,0 +1,205 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * libosxcross C API (libosxcross.h) on top of program::resolveCompiler().
+ */
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include "tools.h"
+#include "target.h"
+#include "progs.h"
+#include "libosxcross.h"
+
+extern char **environ;
+
+using namespace tools;
+using namespace target;
+
+struct osxcross_result {
+  bool ok;
+  std::string compiler;
+  std::string diagnostics;
+  string_vector argv;
+  string_vector env;
+  std::vector<char *> argvptrs;
+  std::vector<char *> envptrs;
+};
+
+namespace {
+
+std::mutex lock;
+
+// Swaps 'environ' for a copy of 'envp' while in scope.
+class EnvironmentScope {
+public:
+  EnvironmentScope(const char *const *envp) : saved(environ) {
+    if (!envp)
+      envp = environ;
+
+    for (; *envp; ++envp)
+      vars.push_back(safeStrdup(*envp));
+
+    vars.push_back(nullptr);
+    environ = vars.data();
+  }
+
+  // setenv() may have replaced the array, but not the strings.
+  ~EnvironmentScope() {
+    environ = saved;
+
+    for (char *var : vars)
+      free(var);
+  }
+
+private:
+  char **saved;
+  std::vector<char *> vars;
+};
+
+// Directory of the wrapper 'argv0' refers to (Target::execpath).
+bool getWrapperDirectory(const char *argv0, std::string &dir) {
+  if (strchr(argv0, PATHDIV)) {
+    char *resolved = realpath(argv0, nullptr);
+
+    if (!resolved)
+      return false;
+
+    dir = resolved;
+    free(resolved);
+  } else if (!findExecutableInPath(argv0, dir, isExecutable)) {
+    return false;
+  }
+
+  stripFileName(dir);
+  return true;
+}
+
+void resolve(const char *argv0, const char *const *args,
+             osxcross_result &result) {
+  std::string execpath;
+
+  if (!getWrapperDirectory(argv0, execpath) ||
+      execpath.size() > PATH_MAX) {
+    err << "cannot find '" << argv0 << "'" << err.endl();
+    return;
+  }
+
+  std::vector<char *> argv;
+  argv.push_back(const_cast<char *>(argv0));
+
+  for (; args && *args; ++args)
+    argv.push_back(const_cast<char *>(*args));
+
+  argv.push_back(nullptr);
+
+  Target target(execpath.c_str());
+
+  if (!program::resolveCompiler(argv.size() - 1, argv.data(), target))
+    return;
+
+  result.compiler = target.compilerpath;
+  result.argv = target.fargs;
+  result.argv.insert(result.argv.end(), target.args.begin(),
+                     target.args.end());
+
+  // What driver::run() exports before executing the compiler.
+  concatEnvVariable("COMPILER_PATH", target.execpath);
+  result.env.push_back(std::string("COMPILER_PATH=") +
+                       getenv("COMPILER_PATH"));
+
+  for (size_t i = 0; i < target.environment.size(); i += 2)
+    result.env.push_back(target.environment[i] + "=" +
+                         target.environment[i + 1]);
+
+  result.ok = true;
+}
+
+void setPointers(string_vector &strs, std::vector<char *> &ptrs) {
+  for (auto &str : strs)
+    ptrs.push_back(const_cast<char *>(str.c_str()));
+
+  ptrs.push_back(nullptr);
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+osxcross_result *osxcross_resolve(const char *argv0, const char *const *args,
+                                  const char *const *envp) {
+  osxcross_result *result = new (std::nothrow) osxcross_result();
+
+  if (!result)
+    return nullptr;
+
+  try {
+    std::lock_guard<std::mutex> guard(lock);
+    EnvironmentScope scope(envp);
+
+    Message::capture = &result->diagnostics;
+    resolve(argv0, args, *result);
+    Message::capture = nullptr;
+  } catch (...) {
+    Message::capture = nullptr;
+    result->ok = false;
+    result->diagnostics += "osxcross: error: out of memory\n";
+  }
+
+  setPointers(result->argv, result->argvptrs);
+  setPointers(result->env, result->envptrs);
+  return result;
+}
+
+int osxcross_result_ok(const osxcross_result *result) { return result->ok; }
+
+const char *osxcross_result_compiler(const osxcross_result *result) {
+  return result->compiler.c_str();
+}
+
+char *const *osxcross_result_argv(const osxcross_result *result) {
+  return result->argvptrs.data();
+}
+
+size_t osxcross_result_argc(const osxcross_result *result) {
+  return result->argv.size();
+}
+
+char *const *osxcross_result_env(const osxcross_result *result) {
+  return result->envptrs.data();
+}
+
+const char *osxcross_result_diagnostics(const osxcross_result *result) {
+  return result->diagnostics.c_str();
+}
+
+void osxcross_result_free(osxcross_result *result) { delete result; }
+
+} // extern "C"
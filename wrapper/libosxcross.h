@@ -0,0 +1,93 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+/*
+ * libosxcross: resolves wrapper invocations (o64-clang -c foo.c, ...) to
+ * the command the wrapper would execute, without starting the wrapper.
+ *
+ *   const char *args[] = { "-c", "foo.c", NULL };
+ *   osxcross_result *r = osxcross_resolve("/opt/osxcross/bin/o64-clang",
+ *                                         args, NULL);
+ *
+ *   if (osxcross_result_ok(r))
+ *     execve(osxcross_result_compiler(r), osxcross_result_argv(r), ...);
+ *   else
+ *     fputs(osxcross_result_diagnostics(r), stderr);
+ *
+ *   osxcross_result_free(r);
+ *
+ * The library is built with the same configuration (target, architectures,
+ * deployment target, ...) as the wrapper it is installed with.
+ * Calls are serialized. While a call runs, it replaces the process
+ * environment ('environ') with the given snapshot; other threads must not
+ * read or modify the environment meanwhile.
+ */
+
+#ifndef OSXCROSS_LIBOSXCROSS_H
+#define OSXCROSS_LIBOSXCROSS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct osxcross_result osxcross_result;
+
+/*
+ * 'argv0': the wrapper the command names (o64-clang, x86_64-apple-darwinXX-
+ *          clang++, ...), either a path or a name looked up in PATH.
+ * 'args':  the remaining arguments, NULL-terminated (may be NULL).
+ * 'envp':  the environment of the invocation, NULL-terminated "NAME=value"
+ *          strings; NULL for the current environment.
+ *
+ * Never returns NULL, apart from out-of-memory. Invocations of programs
+ * other than compilers (xcrun, ld, ...) are not resolved.
+ */
+osxcross_result *osxcross_resolve(const char *argv0, const char *const *args,
+                                  const char *const *envp);
+
+/* Non-zero if the invocation was resolved. */
+int osxcross_result_ok(const osxcross_result *result);
+
+/* Program to execute, e.g. /usr/bin/clang. */
+const char *osxcross_result_compiler(const osxcross_result *result);
+
+/* Its arguments, including argv[0]; NULL-terminated. */
+char *const *osxcross_result_argv(const osxcross_result *result);
+size_t osxcross_result_argc(const osxcross_result *result);
+
+/*
+ * Variables ("NAME=value", NULL-terminated) the wrapper sets for the
+ * compiler, in addition to the given environment.
+ */
+char *const *osxcross_result_env(const osxcross_result *result);
+
+/* Warnings and errors, one per line; "" if there are none. */
+const char *osxcross_result_diagnostics(const osxcross_result *result);
+
+void osxcross_result_free(osxcross_result *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSXCROSS_LIBOSXCROSS_H */
@@ -0,0 +1,300 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tools.h"
+#include "manifest.h"
+#include "trace.h"
+
+extern int debug;
+
+namespace manifest {
+
+using namespace tools;
+
+namespace {
+
+//
+// File layout (host byte order):
+//  Header, Header::numentries * RawEntry, string table
+//
+// All strings are offsets into the NUL-terminated string table.
+//
+
+constexpr char Magic[8] = { 'O', 'C', 'M', 'A', 'N', 'I', 'F', '1' };
+
+struct Header {
+  char magic[8];
+  uint32_t numentries;
+  uint32_t strtabsize;
+};
+
+struct RawEntry {
+  uint32_t type;
+  uint32_t name;
+  uint32_t value;
+  uint32_t aux;
+  uint32_t stamppath;
+  uint32_t stamp;
+};
+
+struct Manifest {
+  const RawEntry *entries;
+  uint32_t numentries;
+  const char *strtab;
+  uint32_t strtabsize;
+} manifest;
+
+bool loaded;
+
+bool validOffset(uint32_t offset) {
+  return offset < manifest.strtabsize;
+}
+
+bool map() {
+  const char *file = getManifestPath();
+
+  if (!file)
+    return false;
+
+  trace::Probe probe("open", file);
+  int fd = open(file, O_RDONLY);
+
+  if (!probe(fd != -1))
+    return false;
+
+  struct stat st;
+  void *data = MAP_FAILED;
+
+  if (!fstat(fd, &st) && st.st_size >= static_cast<off_t>(sizeof(Header)))
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  const size_t size = st.st_size;
+  const Header *header = static_cast<const Header *>(data);
+  const size_t entriessize = header->numentries * sizeof(RawEntry);
+
+  if (memcmp(header->magic, Magic, sizeof(Magic)) ||
+      header->numentries > size / sizeof(RawEntry) ||
+      sizeof(Header) + entriessize + header->strtabsize != size ||
+      !header->strtabsize) {
+    munmap(data, size);
+    return false;
+  }
+
+  manifest.entries = reinterpret_cast<const RawEntry *>(header + 1);
+  manifest.numentries = header->numentries;
+  manifest.strtab = reinterpret_cast<const char *>(manifest.entries) +
+                    entriessize;
+  manifest.strtabsize = header->strtabsize;
+
+  if (manifest.strtab[manifest.strtabsize - 1]) {
+    manifest.numentries = 0;
+    return false;
+  }
+
+  for (uint32_t i = 0; i < manifest.numentries; ++i) {
+    const RawEntry &e = manifest.entries[i];
+
+    if (!validOffset(e.name) || !validOffset(e.value) ||
+        !validOffset(e.aux) || !validOffset(e.stamppath) ||
+        !validOffset(e.stamp)) {
+      manifest.numentries = 0;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const Manifest &get() {
+  if (!loaded) {
+    loaded = true;
+
+    if (!getenv("OSXCROSS_NO_MANIFEST") && !map() && debug >= 2)
+      dbg << "manifest: not available" << dbg.endl();
+  }
+
+  return manifest;
+}
+
+uint32_t addString(std::string &strtab, const std::string &str) {
+  uint32_t offset = strtab.size();
+  strtab += str;
+  strtab += '\0';
+  return offset;
+}
+
+// Tool paths are only trusted while the directory they were found in is
+// still the first PATH directory that has the tool; an earlier one would
+// win the PATH search.
+bool isFirstInPath(const char *dir, const char *name) {
+  const char *path = getenv("PATH");
+  char file[PATH_MAX + 1];
+
+  if (!path || !*dir)
+    return false;
+
+  for (const char *p = path;; ++p) {
+    const char *end = strchr(p, ':');
+    size_t len = end ? end - p : strlen(p);
+
+    if (len == strlen(dir) && !strncmp(p, dir, len))
+      return true;
+
+    if (len && snprintf(file, sizeof(file), "%.*s/%s", int(len), p, name) <
+                   int(sizeof(file))) {
+      trace::Probe probe("access", file);
+
+      if (probe(!access(file, X_OK)))
+        return false;
+    }
+
+    if (!end)
+      return false;
+
+    p = end;
+  }
+}
+
+} // anonymous namespace
+
+const char *getManifestPath() {
+  static char path[PATH_MAX + 1];
+
+  if (!path[0]) {
+    if (!getExecutablePath(path, sizeof(path) - 32))
+      return nullptr;
+
+    strcat(path, "/osxcross.manifest");
+  }
+
+  return path;
+}
+
+bool lookup(EntryType type, const char *name, std::string &value,
+            std::string *aux, std::string *stamppath) {
+  const Manifest &m = get();
+
+  for (uint32_t i = 0; i < m.numentries; ++i) {
+    const RawEntry &e = m.entries[i];
+
+    if (e.type != type || strcmp(m.strtab + e.name, name))
+      continue;
+
+    std::string stamp;
+    getFileStamp(m.strtab + e.stamppath, stamp);
+
+    if (stamp != m.strtab + e.stamp) {
+      if (debug >= 2)
+        dbg << "manifest: '" << m.strtab + e.stamppath << "' changed"
+            << dbg.endl();
+      return false;
+    }
+
+    value = m.strtab + e.value;
+
+    if (aux)
+      *aux = m.strtab + e.aux;
+
+    if (stamppath)
+      *stamppath = m.strtab + e.stamppath;
+
+    return true;
+  }
+
+  return false;
+}
+
+bool lookupTool(const char *name, std::string &path) {
+  std::string dir;
+
+  if (!lookup(Tool, name, path, &dir))
+    return false;
+
+  return isFirstInPath(dir.c_str(), name);
+}
+
+void execTool(const char *file, char *const argv[]) {
+  std::string path;
+
+  if (lookupTool(file, path)) {
+    trace::exec(path.c_str());
+    execv(path.c_str(), argv);
+  }
+
+  trace::exec(file);
+
+  execvp(file, argv);
+}
+
+bool write(const char *file, const std::vector<Entry> &entries) {
+  std::string strtab(1, '\0'); // never empty
+  std::vector<RawEntry> rawentries;
+  std::string stamp;
+
+  for (auto &entry : entries) {
+    RawEntry e;
+
+    getFileStamp(entry.stamppath, stamp);
+
+    e.type = entry.type;
+    e.name = addString(strtab, entry.name);
+    e.value = addString(strtab, entry.value);
+    e.aux = addString(strtab, entry.aux);
+    e.stamppath = addString(strtab, entry.stamppath);
+    e.stamp = addString(strtab, stamp);
+
+    rawentries.push_back(e);
+  }
+
+  Header header;
+  memcpy(header.magic, Magic, sizeof(Magic));
+  header.numentries = rawentries.size();
+  header.strtabsize = strtab.size();
+
+  std::string content;
+  content.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  content.append(reinterpret_cast<const char *>(rawentries.data()),
+                 rawentries.size() * sizeof(RawEntry));
+  content += strtab;
+
+  return writeFileContentAtomic(file, content);
+}
+
+} // namespace manifest
@@ -0,0 +1,63 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace manifest {
+
+//
+// Toolchain layout manifest
+//
+// Written by 'osxcross-manifest' at install time (see build_wrapper.sh) and
+// stored next to the wrapper. It records the answers of the wrapper's file
+// system probes (intrinsic headers, GCC versions, tool locations) together
+// with the state of the file or directory each answer was derived from.
+// Entries whose file or directory changed since are ignored, and the wrapper
+// falls back to probing.
+//
+
+enum EntryType : unsigned int {
+  Tool = 1,            // name: tool, value: path, aux: PATH dir it was found in
+  ClangIntrinsics = 2, // name: compiler path, value: dir, aux: clang version
+  GCCVersion = 3,      // name: <...>/include/c++ dir, value: GCC version
+  Fingerprint = 4      // name: file or dir, value: tools::hashFileTree(),
+                       // aux: tools::hashFileTreeStamps()
+};
+
+struct Entry {
+  EntryType type;
+  std::string name;
+  std::string value;
+  std::string aux;
+  std::string stamppath;
+};
+
+const char *getManifestPath();
+
+bool lookup(EntryType type, const char *name, std::string &value,
+            std::string *aux = nullptr, std::string *stamppath = nullptr);
+bool lookupTool(const char *name, std::string &path);
+
+// execvp() replacement that uses the recorded location of 'file' if valid.
+// Only returns on failure.
+void execTool(const char *file, char *const argv[]);
+
+bool write(const char *file, const std::vector<Entry> &entries);
+
+} // namespace manifest
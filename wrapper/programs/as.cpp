@@ -72,9 +72,14 @@ int as(int argc, char **argv, target::Target &target) {
     givenArgs.push_back(argv[i]);
   }
 
+  // Resolve '<default triple>-clang' in-process rather than through
+  // 'xcrun clang', which would re-enter the wrapper twice.
+  std::string compiler;
+  target.buildDefaultTriple(compiler);
+  compiler += "-clang";
+
   std::vector<char *> args;
-  args.push_back(const_cast<char *>("xcrun"));
-  args.push_back(const_cast<char *>("clang"));
+  args.push_back(const_cast<char *>(compiler.c_str()));
 
   // Force assembler input even for stdin or files without a .s suffix. These
   // options must precede a synthesized "-" or Clang rejects stdin input.
@@ -119,10 +124,7 @@ int as(int argc, char **argv, target::Target &target) {
     printExternalToolArgs(argc, argv, args);
 
   args.push_back(nullptr);
-  execvp(args[0], args.data());
-
-  err << "Couldn't execute " << args[0] << err.endl();
-  return 1;
+  return executeCompiler(static_cast<int>(args.size() - 1), args.data());
 }
 
 } // namespace clang
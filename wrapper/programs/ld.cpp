@@ -25,6 +25,7 @@ namespace program {
 namespace llvm {
 
 using tools::err;
+using tools::out;
 using tools::safeStrdup;
 
 // This linker wrapper is specific to the LLVM build flavor. It translates
@@ -42,9 +43,9 @@ int ld(int argc, char **argv, target::Target &target) {
   // linker. Imitate that format for compatibility. The ld64 project version
   // below is synthetic; use --version to print the actual LLD version.
   if (argc >= 2 && !strcmp(argv[1], "-v")) {
-    std::cout << "@(#)PROGRAM:ld  PROJECT:ld64-9999.9 "
-                 "(lld - use --version to see the LLVM version)"
-              << std::endl;
+    out << "@(#)PROGRAM:ld  PROJECT:ld64-9999.9 "
+           "(lld - use --version to see the LLVM version)"
+        << '\n';
     return 0;
   }
 
@@ -81,8 +82,13 @@ int ld(int argc, char **argv, target::Target &target) {
   // ld64.lld needs both the deployment target and SDK version. Synthesize the
   // tuple when the caller only supplied the legacy option (or no version).
   if (!platformVersionSeen) {
+    // Prefer the deployment target of the compiler invocation that started
+    // the linker (see Target::loadHandoff()).
     if (!minimumVersion)
-      minimumVersion = safeStrdup(target::getDefaultMinTarget().shortStr().c_str());
+      minimumVersion = safeStrdup((target.OSNum.Num()
+                                       ? target.OSNum
+                                       : target::getDefaultMinTarget())
+                                      .shortStr().c_str());
 
     args.insert(args.begin() + 1,
                 {const_cast<char *>("-platform_version"),
@@ -95,7 +101,7 @@ int ld(int argc, char **argv, target::Target &target) {
     printExternalToolArgs(argc, argv, args);
 
   args.push_back(nullptr);
-  execvp(args[0], args.data());
+  manifest::execTool(args[0], args.data());
 
   err << "Couldn't execute " << args[0] << err.endl();
   return 1;
@@ -0,0 +1,116 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "proginc.h"
+#include "compilecache.h"
+
+using namespace tools;
+using namespace target;
+
+namespace program {
+namespace osxcross {
+
+namespace {
+
+void cacheUsage() {
+  errout << "usage: osxcross-cache [-s|--show-stats] [-z|--zero-stats] "
+         << "[-c|--cleanup] [-C|--clear]\n";
+}
+
+void printSize(const char *name, unsigned long long size) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%-16s%.1f MB\n", name, size / 1048576.0);
+  out << buf;
+}
+
+void printCounter(const char *name, unsigned long long value) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%-16s%llu\n", name, value);
+  out << buf;
+}
+
+} // anonymous namespace
+
+int cache(int argc, char **argv) {
+  typedef ::compilecache::Stats Stats;
+  const char *cachedir = ::compilecache::getCacheDir();
+  unsigned long long limit = ::compilecache::getSizeLimit();
+  Stats stats = Stats();
+
+  if (!cachedir) {
+    err << "'OSXCROSS_COMPILE_CACHE_DIR' (env) is not set" << err.endl();
+    return 1;
+  }
+
+  if (argc < 2) {
+    static char show[] = "-s";
+    static char *args[] = { argv[0], show, nullptr };
+    return cache(2, args);
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    bool ok = true;
+
+    if (!strcmp(arg, "-s") || !strcmp(arg, "--show-stats")) {
+      // Recount the store, without evicting anything.
+      if ((ok = ::compilecache::cleanup(cachedir, 0, stats))) {
+        unsigned long long hits = stats.counters[::compilecache::Hits];
+        unsigned long long misses = stats.counters[::compilecache::Misses];
+        char rate[32];
+
+        snprintf(rate, sizeof(rate), "%.1f %%",
+                 hits + misses ? hits * 100.0 / (hits + misses) : 0.0);
+
+        out << "cache directory " << cachedir << '\n';
+        printCounter("hits", hits);
+        printCounter("misses", misses);
+        printCounter("uncacheable",
+                     stats.counters[::compilecache::Uncacheable]);
+        out << "hit rate        " << rate << '\n';
+        printCounter("entries", stats.entries);
+        printSize("size", stats.counters[::compilecache::Size]);
+
+        if (limit)
+          printSize("size limit", limit);
+      }
+    } else if (!strcmp(arg, "-z") || !strcmp(arg, "--zero-stats")) {
+      ok = ::compilecache::zeroStats(cachedir);
+    } else if (!strcmp(arg, "-c") || !strcmp(arg, "--cleanup")) {
+      ok = ::compilecache::cleanup(cachedir, limit, stats);
+    } else if (!strcmp(arg, "-C") || !strcmp(arg, "--clear")) {
+      ok = ::compilecache::clear(cachedir);
+    } else {
+      cacheUsage();
+      return 1;
+    }
+
+    if (!ok) {
+      err << "cannot update '" << cachedir << "'" << err.endl();
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+} // namespace osxcross
+} // namespace program
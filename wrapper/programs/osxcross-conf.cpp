@@ -30,7 +30,7 @@ namespace osxcross {
 template<typename A>
 
 void print(const char *var, const A &val) {
-  std::cout << "export OSXCROSS_" << var << "=" << "\"" << val << "\"" << std::endl;
+  out << "export OSXCROSS_" << var << "=" << "\"" << val << "\"" << '\n';
 }
 
 int conf(Target &target) {
@@ -61,6 +61,8 @@ int conf(Target &target) {
   print("SDK", SDKPath);
   print("SDK_DIR", SDKPath + "/..");
   print("SDK_VERSION", target.getSDKOSNum().shortStr());
+  print("SDK_DEFAULT_DEPLOYMENT_TARGET",
+        target.getSDKDefaultDeploymentTarget().shortStr());
   print("TARBALL_DIR", BuildDir + "/../tarballs");
   print("PATCH_DIR", BuildDir + "/../patches");
   print("TARGET_DIR", std::string(target.execpath) + "/..");
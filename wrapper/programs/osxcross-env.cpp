@@ -42,11 +42,11 @@ int env(int argc, char **argv) {
     const std::string &pname = getParentProcessName();
 
     if (pname == "csh" || pname == "tcsh") {
-      std::cerr << std::endl << "you are invoking this program from a C shell, "
-                << std::endl << "please use " << std::endl << std::endl
-                << "setenv PATH `" << epath << "/osxcross-env -v=PATH`"
-                << std::endl << std::endl << "instead." << std::endl
-                << std::endl;
+      errout << '\n' << "you are invoking this program from a C shell, "
+             << '\n' << "please use " << '\n' << '\n'
+             << "setenv PATH `" << epath << "/osxcross-env -v=PATH`"
+             << '\n' << '\n' << "instead." << '\n'
+             << '\n';
     }
   }
 
@@ -63,20 +63,20 @@ int env(int argc, char **argv) {
   auto printVariable = [&](const std::string & var)->bool {
     auto it = vars.find(var);
     if (it == vars.end()) {
-      std::cerr << "unknown variable '" << var << "'" << std::endl;
+      errout << "unknown variable '" << var << "'" << '\n';
       return false;
     }
-    std::cout << it->second << std::endl;
+    out << it->second << '\n';
     return true;
   };
 
   if (argc <= 1) {
-    std::cout << std::endl;
+    out << '\n';
     for (auto &v : vars) {
-      std::cout << "export " << v.first << "=";
+      out << "export " << v.first << "=";
       if (!printVariable(v.first))
         return 1;
-      std::cout << std::endl;
+      out << '\n';
     }
   } else {
     if (strncmp(argv[1], "-v=", 3))
@@ -88,6 +88,7 @@ int man(int argc, char **argv, Target &target) {
 
   args.push_back(nullptr);
 
+  trace::exec(args[0]);
   execvp(args[0], args.data());
   err << "cannot execute '" << args[0] << "'" << err.endl();
   return 1;
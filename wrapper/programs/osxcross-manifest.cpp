@@ -0,0 +1,182 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "proginc.h"
+#include <sys/stat.h>
+
+using namespace tools;
+using namespace target;
+
+namespace program {
+namespace osxcross {
+
+namespace {
+
+// Tools that are executed by the wrapper but are not part of programs[].
+constexpr const char *ExtraTools[] = {
+  "ld64.lld", "osxcross-cctools-lipo", "llvm-lipo", "pkg-config"
+};
+
+constexpr const char *Compilers[] = { "clang", "clang++" };
+
+// Mirrors the lookup done by execvp() (or by Target::setCompilerPath() for
+// compilers) and returns the PATH directory the tool was found in as well.
+bool findTool(const char *name, bool compiler, std::string &path,
+              std::string &dir) {
+  const char *envpath = getenv("PATH");
+  std::vector<std::string> dirs;
+  struct stat st;
+
+  if (envpath)
+    splitPath(envpath, dirs);
+
+  for (auto &d : dirs) {
+    path = d;
+    path += PATHDIV;
+    path += name;
+
+    if (stat(path.c_str(), &st) || !isExecutable(path.c_str(), st))
+      continue;
+
+    if (compiler) {
+      char *resolved = realpath(path.c_str(), nullptr);
+
+      if (!resolved)
+        continue;
+
+      path = resolved;
+      free(resolved);
+
+      if (!ignoreCCACHE(path.c_str(), st))
+        continue;
+    }
+
+    dir = d;
+    return true;
+  }
+
+  return false;
+}
+
+} // anonymous namespace
+
+int manifest(Target &target) {
+  typedef ::manifest::Entry Entry;
+  std::vector<Entry> entries;
+  std::string path;
+  std::string dir;
+
+  // Probe the file system rather than answering from an existing manifest.
+  setenv("OSXCROSS_NO_MANIFEST", "1", 1);
+
+  auto addTool = [&](const char *name, bool compiler) {
+    for (auto &e : entries)
+      if (e.type == ::manifest::Tool && e.name == name)
+        return;
+
+    if (findTool(name, compiler, path, dir))
+      entries.push_back({::manifest::Tool, name, path, dir, path});
+  };
+
+  for (auto &prog : programs)
+    if (const char *tool = prog.getTool())
+      addTool(tool, false);
+
+  for (const char *tool : ExtraTools)
+    addTool(tool, false);
+
+  for (const char *compiler : Compilers) {
+    Target clang;
+    std::string intrinsicdir;
+
+    addTool(compiler, true);
+
+    clang.compiler = getCompilerIdentifier(compiler);
+    clang.compilername = compiler;
+    clang.setCompilerPath();
+
+    bool known = false;
+
+    for (auto &e : entries)
+      if (e.type == ::manifest::ClangIntrinsics && e.name == clang.compilerpath)
+        known = true;
+
+    if (!known && clang.findClangIntrinsicHeaders(intrinsicdir))
+      entries.push_back({::manifest::ClangIntrinsics, clang.compilerpath,
+                         intrinsicdir, clang.clangversion.Str(),
+                         clang.dependencies.back()});
+  }
+
+  std::string SDKPath;
+
+  if (target.getSDKPath(SDKPath)) {
+    constexpr Arch GCCArchs[] = { Arch::aarch64, Arch::x86_64 };
+
+    for (Arch arch : GCCArchs) {
+      std::string CXXHeaderPath = SDKPath;
+      GCCVersion gccversion;
+
+      CXXHeaderPath += "/../../";
+      CXXHeaderPath += getArchName(arch);
+      CXXHeaderPath += "-";
+      CXXHeaderPath += target.vendor;
+      CXXHeaderPath += "-";
+      CXXHeaderPath += target.target;
+      CXXHeaderPath += "/include/c++";
+
+      if (dirExists(CXXHeaderPath) &&
+          target.findGCCVersion(CXXHeaderPath, gccversion))
+        entries.push_back({::manifest::GCCVersion, CXXHeaderPath,
+                           gccversion.Str(), std::string(), CXXHeaderPath});
+    }
+  }
+
+  // osxcross --fingerprint
+  string_vector paths;
+
+  if (getFingerprintPaths(target, paths)) {
+    for (auto &path : paths) {
+      hash_type hash;
+      hash_type stamps;
+
+      if (hashFileTree(path, hash) && hashFileTreeStamps(path, stamps))
+        entries.push_back({::manifest::Fingerprint, path, hashToString(hash),
+                           hashToString(stamps), path});
+    }
+  }
+
+  const char *file = ::manifest::getManifestPath();
+
+  if (!file || !::manifest::write(file, entries)) {
+    err << "cannot write '" << (file ? file : "manifest") << "'"
+        << err.endl();
+    return 1;
+  }
+
+  if (debug)
+    dbg << "wrote " << entries.size() << " entries to '" << file << "'"
+        << dbg.endl();
+
+  return 0;
+}
+
+} // namespace osxcross
+} // namespace program
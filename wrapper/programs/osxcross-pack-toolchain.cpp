@@ -0,0 +1,628 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "proginc.h"
+#include <map>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+using namespace tools;
+using namespace target;
+
+namespace program {
+namespace osxcross {
+
+namespace {
+
+void packUsage() {
+  errout << "usage: osxcross-pack-toolchain [-o <dir>]\n";
+}
+
+//
+// Archive members, keyed by their absolute path on this host. The map keeps
+// them sorted, so the archive does not depend on the order they were found in.
+//
+
+struct Member {
+  char type;        // tar typeflag: '0' file, '2' symlink, '5' directory
+  mode_t mode;
+  std::string link; // symlink target
+};
+
+typedef std::map<std::string, Member> Members;
+
+// "/a/b" -> "/a", "/a" -> ""
+void stripLastComponent(std::string &path) {
+  size_t pathdiv = path.find_last_of(PATHDIV);
+  path.resize(pathdiv == std::string::npos ? 0 : pathdiv);
+}
+
+bool readLink(const std::string &path, std::string &target) {
+  char buf[PATH_MAX + 1];
+  ssize_t len = readlink(path.c_str(), buf, sizeof(buf) - 1);
+
+  if (len < 0)
+    return false;
+
+  target.assign(buf, len);
+  return true;
+}
+
+bool addMember(Members &members, const std::string &path,
+               const struct stat &st) {
+  if (S_ISLNK(st.st_mode)) {
+    std::string target;
+
+    if (!readLink(path, target))
+      return false;
+
+    members[path] = { '2', 0777, target };
+  } else if (S_ISDIR(st.st_mode)) {
+    members.insert({ path, { '5', 0755, std::string() } });
+  } else if (S_ISREG(st.st_mode)) {
+    members[path] = { '0', mode_t(st.st_mode & 0111 ? 0755 : 0644),
+                      std::string() };
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// Adds 'path' along with every directory and symlink it takes to reach it,
+// so the same path resolves within the extracted archive.
+bool addPath(Members &members, const std::string &path,
+             std::string *resolved = nullptr) {
+  std::vector<std::string> pending; // components left to walk, reversed
+  std::string current;
+  int links = 0;
+
+  auto push = [&](const std::string &path) {
+    std::vector<std::string> components;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= path.size(); ++i) {
+      if (i == path.size() || path[i] == PATHDIV) {
+        if (i > start)
+          components.push_back(path.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+
+    pending.insert(pending.end(), components.rbegin(), components.rend());
+  };
+
+  if (path.empty())
+    return false;
+
+  push(path);
+
+  if (path[0] != PATHDIV) {
+    char *cwd = getcwd(nullptr, 0);
+
+    if (!cwd)
+      return false;
+
+    push(cwd);
+    free(cwd);
+  }
+
+  while (!pending.empty()) {
+    std::string component;
+    struct stat st;
+
+    component.swap(pending.back());
+    pending.pop_back();
+
+    if (component == ".")
+      continue;
+
+    if (component == "..") {
+      stripLastComponent(current);
+      continue;
+    }
+
+    std::string next = current + PATHDIV + component;
+
+    if (lstat(next.c_str(), &st) || !addMember(members, next, st))
+      return false;
+
+    if (S_ISLNK(st.st_mode)) {
+      const std::string &target = members[next].link;
+
+      if (++links > 40)
+        return false;
+
+      if (target[0] == PATHDIV)
+        current.clear();
+
+      push(target);
+      continue;
+    }
+
+    current.swap(next);
+  }
+
+  if (resolved)
+    *resolved = current.empty() ? std::string(1, PATHDIV) : current;
+
+  return true;
+}
+
+typedef bool (*memberfilter)(const std::string &path, const struct stat &st);
+
+// Adds the content of the (resolved) directory 'dir', symlinks as they are.
+bool addTree(Members &members, const std::string &dir,
+             memberfilter filter = nullptr) {
+  std::vector<std::string> files;
+
+  if (!listFiles(dir.c_str(), &files, [](const char *name) {
+        return strcmp(name, ".") && strcmp(name, "..");
+      }))
+    return false;
+
+  for (auto &file : files) {
+    std::string path = dir + PATHDIV + file;
+    struct stat st;
+
+    if (lstat(path.c_str(), &st))
+      return false;
+
+    if (S_ISDIR(st.st_mode)) {
+      if (!addTree(members, path, filter))
+        return false;
+
+      // Keep (empty) header directories, e.g. include/c++/v1.
+      if (!filter || filter(path, st))
+        addMember(members, path, st);
+    } else if (!filter || filter(path, st)) {
+      if (!addMember(members, path, st))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Directories of members found by addTree().
+void addParentDirectories(Members &members) {
+  string_vector dirs;
+
+  for (auto &member : members) {
+    std::string dir = member.first;
+
+    for (stripLastComponent(dir); !dir.empty(); stripLastComponent(dir))
+      if (!members.count(dir))
+        dirs.push_back(dir);
+  }
+
+  for (auto &dir : dirs)
+    members.insert({ dir, { '5', 0755, std::string() } });
+}
+
+bool isLibrary(const char *name) {
+  const char *ext = getFileExtension(name);
+  return ext && (!strcmp(ext, ".tbd") || !strcmp(ext, ".dylib") ||
+                 !strcmp(ext, ".a") || !strcmp(ext, ".o"));
+}
+
+// SDK headers, module maps and settings; no libraries or stubs.
+bool isSDKHeader(const std::string &path, const struct stat &st) {
+  const char *name = getFileName(path);
+
+  if (S_ISLNK(st.st_mode))
+    return !isLibrary(name);
+
+  if (S_ISDIR(st.st_mode))
+    return path.find("/include") != std::string::npos ||
+           path.find("/Headers") != std::string::npos;
+
+  return path.find("/include/") != std::string::npos ||
+         path.find("/Headers/") != std::string::npos ||
+         path.find("/PrivateHeaders/") != std::string::npos ||
+         endsWith(path, ".modulemap") || !strncmp(name, "SDKSettings.", 12);
+}
+
+// The shared libraries 'binary' is linked to, as listed by ldd.
+bool getSharedLibraries(const std::string &binary, string_vector &libs) {
+  FILE *tmp = tmpfile();
+  std::string output;
+
+  if (!tmp)
+    return false;
+
+  string_vector cmd = { "ldd", binary };
+  int rc = waitProcess(spawnProcess(cmd[0], cmd, fileno(tmp), fileno(tmp)));
+
+  rewind(tmp);
+  bool ok = getFDContent(fileno(tmp), output);
+
+  fclose(tmp);
+
+  // "not a dynamic executable" fails as well.
+  if (rc || !ok)
+    return false;
+
+  for (size_t pos = 0; pos < output.size();) {
+    size_t end = output.find('\n', pos);
+
+    if (end == std::string::npos)
+      end = output.size();
+
+    std::string line = output.substr(pos, end - pos);
+    size_t arrow = line.find("=> ");
+    size_t start = arrow != std::string::npos ? arrow + 3
+                                              : line.find_first_not_of(" \t");
+
+    if (start != std::string::npos && line[start] == PATHDIV)
+      libs.push_back(line.substr(start, line.find(" (", start) - start));
+
+    pos = end + 1;
+  }
+
+  return true;
+}
+
+//
+// Reproducible ustar writer: members in path order, owned by root, with a
+// fixed mtime and normalized modes. Long names go into pax headers.
+//
+
+class TarWriter {
+public:
+  TarWriter(int fd, unsigned long long mtime)
+      : output(fd), mtime(mtime), hash(FNV1aBasis), size() {}
+
+  void addMember(const std::string &name, char type, mode_t mode,
+                 const std::string &link = std::string(),
+                 const std::string *content = nullptr);
+  bool finish();
+
+  hash_type getHash() const { return hash; }
+
+private:
+  void write(const char *data, size_t len) {
+    output.write(data, len);
+    hash = hashData(data, len, hash);
+    size += len;
+  }
+
+  void pad() {
+    static const char zeros[512] = {};
+    if (size % 512)
+      write(zeros, 512 - size % 512);
+  }
+
+  void putHeader(const std::string &name, char type, mode_t mode,
+                 size_t filesize, const std::string &link);
+
+  Output output;
+  unsigned long long mtime;
+  hash_type hash;
+  unsigned long long size;
+};
+
+void TarWriter::putHeader(const std::string &name, char type, mode_t mode,
+                          size_t filesize, const std::string &link) {
+  char header[512] = {};
+
+  memcpy(header, name.c_str(), std::min<size_t>(name.size(), 100));
+  snprintf(header + 100, 8, "%07o", unsigned(mode));
+  snprintf(header + 108, 8, "%07o", 0);
+  snprintf(header + 116, 8, "%07o", 0);
+  snprintf(header + 124, 12, "%011llo", (unsigned long long)filesize);
+  snprintf(header + 136, 12, "%011llo", mtime);
+  memset(header + 148, ' ', 8);
+  header[156] = type;
+  memcpy(header + 157, link.c_str(), std::min<size_t>(link.size(), 100));
+  memcpy(header + 257, "ustar", 6);
+  memcpy(header + 263, "00", 2);
+  memcpy(header + 265, "root", 4);
+  memcpy(header + 297, "root", 4);
+
+  unsigned checksum = 0;
+
+  for (unsigned char c : header)
+    checksum += c;
+
+  snprintf(header + 148, 8, "%06o", checksum);
+  write(header, sizeof(header));
+}
+
+void TarWriter::addMember(const std::string &name, char type, mode_t mode,
+                          const std::string &link,
+                          const std::string *content) {
+  std::string pax;
+
+  auto addRecord = [&](const char *key, const std::string &value) {
+    // "<length> <key>=<value>\n", the length counting its own digits.
+    size_t len = strlen(key) + value.size() + 3;
+    size_t digits = 1;
+
+    while (std::to_string(len + digits).size() > digits)
+      ++digits;
+
+    pax += std::to_string(len + digits);
+    pax += ' ';
+    pax += key;
+    pax += '=';
+    pax += value;
+    pax += '\n';
+  };
+
+  if (name.size() > 100)
+    addRecord("path", name);
+
+  if (link.size() > 100)
+    addRecord("linkpath", link);
+
+  if (!pax.empty()) {
+    putHeader("PaxHeader/" + std::string(getFileName(name)).substr(0, 80),
+              'x', 0644, pax.size(), std::string());
+    write(pax.data(), pax.size());
+    pad();
+  }
+
+  putHeader(name, type, mode, content ? content->size() : 0, link);
+
+  if (content) {
+    write(content->data(), content->size());
+    pad();
+  }
+}
+
+bool TarWriter::finish() {
+  static const char zeros[512] = {};
+
+  // Two zero blocks, rounded up to the default 10240 byte record.
+  write(zeros, 512);
+  write(zeros, 512);
+
+  while (size % 10240)
+    write(zeros, 512);
+
+  return output.flush();
+}
+
+bool collect(Target &target, Members &members) {
+  constexpr const char *Compilers[] = { "clang", "clang++" };
+  char buf[PATH_MAX + 1];
+  std::string wrapper;
+  string_vector binaries;
+
+  // The wrapper and its links, so the client's command line works remotely.
+  if (!getExecutableFile(buf, sizeof(buf)) ||
+      !addPath(members, buf, &wrapper)) {
+    err << "cannot find the wrapper executable" << err.endl();
+    return false;
+  }
+
+  binaries.push_back(wrapper);
+
+  std::vector<std::string> files;
+  listFiles(target.execpath, &files, nullptr);
+
+  for (auto &file : files) {
+    std::string path = std::string(target.execpath) + PATHDIV + file;
+    char *resolved = realpath(path.c_str(), nullptr);
+    struct stat st;
+
+    if (resolved && resolved == wrapper && !lstat(path.c_str(), &st) &&
+        S_ISLNK(st.st_mode))
+      addPath(members, path);
+
+    free(resolved);
+  }
+
+  // The compilers, their intrinsic headers and /usr/bin/clang(++) as
+  // expected by icecc.
+  for (const char *compiler : Compilers) {
+    Target clang;
+    std::string compilerpath;
+    std::string intrinsicdir;
+
+    clang.compiler = getCompilerIdentifier(compiler);
+    clang.compilername = compiler;
+    clang.setCompilerPath();
+
+    if (!addPath(members, clang.compilerpath, &compilerpath)) {
+      err << "cannot find '" << compiler << "'" << err.endl();
+      return false;
+    }
+
+    binaries.push_back(compilerpath);
+
+    if (!clang.findClangIntrinsicHeaders(intrinsicdir) ||
+        !addPath(members, intrinsicdir, &intrinsicdir) ||
+        !addTree(members, intrinsicdir)) {
+      err << "cannot find the intrinsic headers of '" << compiler << "'"
+          << err.endl();
+      return false;
+    }
+
+    std::string usrbin = "/usr/bin/";
+    usrbin += compiler;
+
+    if (!members.count(usrbin))
+      members[usrbin] = { '2', 0777, compilerpath };
+  }
+
+  // icecc checks environments by running /bin/true.
+  std::string truepath;
+
+  if (addPath(members, "/bin/true", &truepath))
+    binaries.push_back(truepath);
+
+  for (auto &binary : binaries) {
+    string_vector libs;
+
+    if (!getSharedLibraries(binary, libs)) {
+      if (debug)
+        dbg << "pack-toolchain: no shared libraries listed for '" << binary
+            << "'" << dbg.endl();
+      continue;
+    }
+
+    for (auto &lib : libs) {
+      if (!addPath(members, lib)) {
+        err << "cannot read '" << lib << "'" << err.endl();
+        return false;
+      }
+    }
+  }
+
+  std::string SDKPath;
+
+  if (!target.getSDKPath(SDKPath) || !addPath(members, SDKPath, &SDKPath) ||
+      !addTree(members, SDKPath, isSDKHeader)) {
+    err << "cannot read the SDK" << err.endl();
+    return false;
+  }
+
+  members["/tmp"] = { '5', 01777, std::string() };
+  addParentDirectories(members);
+  return true;
+}
+
+// Writes the members, identical files as hard links to the first copy.
+bool writeArchive(const Members &members, TarWriter &tar) {
+  std::map<std::pair<size_t, hash_type>, std::string> seen;
+  std::string content;
+
+  for (auto &member : members) {
+    std::string name = member.first.substr(1);
+    const Member &m = member.second;
+
+    if (m.type == '5') {
+      tar.addMember(name + PATHDIV, m.type, m.mode);
+      continue;
+    }
+
+    if (m.type == '2') {
+      tar.addMember(name, m.type, m.mode, m.link);
+      continue;
+    }
+
+    if (!getFileContent(member.first, content)) {
+      err << "cannot read '" << member.first << "'" << err.endl();
+      return false;
+    }
+
+    auto key = std::make_pair(content.size(), hashString(content));
+    auto it = seen.find(key);
+
+    if (it != seen.end()) {
+      std::string first;
+
+      if (getFileContent(PATHDIV + it->second, first) && first == content) {
+        tar.addMember(name, '1', m.mode, it->second);
+        continue;
+      }
+    } else {
+      seen[key] = name;
+    }
+
+    tar.addMember(name, m.type, m.mode, std::string(), &content);
+  }
+
+  return tar.finish();
+}
+
+} // anonymous namespace
+
+int pack_toolchain(int argc, char **argv, Target &target) {
+  std::string outdir = ".";
+  Members members;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      outdir = argv[++i];
+    } else {
+      packUsage();
+      return 1;
+    }
+  }
+
+  // Probe the file system; the paths recorded in the manifest are only
+  // valid on this host.
+  setenv("OSXCROSS_NO_MANIFEST", "1", 1);
+
+  if (!collect(target, members))
+    return 1;
+
+  unsigned long long mtime = 0;
+
+  if (const char *epoch = getenv("SOURCE_DATE_EPOCH"))
+    mtime = strtoull(epoch, nullptr, 10);
+
+  std::string tmpfile = outdir;
+  tmpfile += "/.osxcross-toolchain.";
+  tmpfile += std::to_string(getpid());
+  tmpfile += ".tar";
+
+  int fd = open(tmpfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+
+  if (fd == -1) {
+    err << "cannot write '" << tmpfile << "'" << err.endl();
+    return 1;
+  }
+
+  hash_type hash;
+  bool ok;
+
+  {
+    TarWriter tar(fd, mtime);
+    ok = writeArchive(members, tar);
+    hash = tar.getHash();
+  }
+
+  ok &= !close(fd);
+
+  // Named by content, like icecc names its environments.
+  std::string archive = outdir;
+  archive += "/osxcross-toolchain-";
+  archive += hashToString(hash);
+  archive += ".tar";
+
+  if (!ok || rename(tmpfile.c_str(), archive.c_str())) {
+    err << "cannot write '" << archive << "'" << err.endl();
+    unlink(tmpfile.c_str());
+    return 1;
+  }
+
+  // -n: no name or timestamp in the gzip header.
+  string_vector cmd = { "gzip", "-n", "-f", archive };
+
+  if (!waitProcess(spawnProcess(cmd[0], cmd)))
+    archive += ".gz";
+  else
+    warn << "cannot compress '" << archive << "'" << warn.endl();
+
+  if (debug)
+    dbg << "pack-toolchain: " << members.size() << " members" << dbg.endl();
+
+  out << archive << '\n';
+  return 0;
+}
+
+} // namespace osxcross
+} // namespace program
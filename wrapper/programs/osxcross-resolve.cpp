@@ -0,0 +1,638 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "proginc.h"
+#include <map>
+#include <cctype>
+
+extern char **environ;
+
+using namespace tools;
+using namespace target;
+
+namespace program {
+namespace osxcross {
+
+namespace {
+
+void putJSONString(std::string &out, const std::string &str) {
+  out += '"';
+  escapeJSON(out, str.c_str());
+  out += '"';
+}
+
+void putJSONArray(std::string &out, const string_vector &v) {
+  out += '[';
+
+  for (size_t i = 0; i < v.size(); ++i) {
+    if (i)
+      out += ',';
+
+    putJSONString(out, v[i]);
+  }
+
+  out += ']';
+}
+
+// Resolves any number of compiler invocations in this process.
+class Resolver {
+public:
+  Resolver(const Target &target) : proto(target) {
+    for (char **env = environ; *env; ++env) {
+      const char *p = strchr(*env, '=');
+
+      if (p)
+        initialenv[std::string(*env, p - *env)] = p + 1;
+    }
+  }
+
+  // Target::Target() already ran for this process (execpath, defaults).
+  Target newTarget() const { return proto; }
+
+  // 'target' comes from newTarget(). On success, target.environment starts
+  // with COMPILER_PATH, followed by the variables setup() exported.
+  bool resolve(const string_vector &args, Target &target) {
+    std::vector<char *> argv;
+
+    for (auto &arg : args)
+      argv.push_back(const_cast<char *>(arg.c_str()));
+
+    argv.push_back(nullptr);
+
+    bool ok = resolveCompiler(argv.size() - 1, argv.data(), target);
+
+    if (ok) {
+      concatEnvVariable("COMPILER_PATH", target.execpath);
+      target.environment.insert(target.environment.begin(),
+                                {"COMPILER_PATH", getenv("COMPILER_PATH")});
+    }
+
+    // Invocations must not see each other's exports (e.g. the handoff
+    // record of Target::storeHandoff()).
+    for (size_t i = 0; i < target.environment.size(); i += 2) {
+      auto it = initialenv.find(target.environment[i]);
+
+      if (it != initialenv.end())
+        setenv(it->first.c_str(), it->second.c_str(), 1);
+      else
+        unsetenv(target.environment[i].c_str());
+    }
+
+    return ok;
+  }
+
+private:
+  const Target proto;
+  std::map<std::string, std::string> initialenv;
+};
+
+//
+// osxcross-resolve
+//
+
+void resolveUsage() {
+  errout << "usage: osxcross-resolve [-0] --stdin\n"
+         << "       osxcross-resolve <compiler> [args...]\n";
+}
+
+// Writes one JSON line; returns false if 'args' cannot be resolved.
+bool printResolved(Resolver &resolver, size_t line,
+                   const string_vector &args) {
+  Target target = resolver.newTarget();
+  std::string out;
+
+  out = "{\"line\":";
+  out += std::to_string(line);
+  out += ",\"command\":";
+  putJSONArray(out, args);
+
+  bool ok = resolver.resolve(args, target);
+
+  if (ok) {
+    string_vector argv = target.fargs;
+    argv.insert(argv.end(), target.args.begin(), target.args.end());
+
+    out += ",\"compiler\":";
+    putJSONString(out, target.compilerpath);
+    out += ",\"arguments\":";
+    putJSONArray(out, argv);
+    out += ",\"environment\":{";
+
+    for (size_t i = 0; i < target.environment.size(); i += 2) {
+      if (i)
+        out += ',';
+
+      putJSONString(out, target.environment[i]);
+      out += ':';
+      putJSONString(out, target.environment[i + 1]);
+    }
+
+    out += '}';
+  } else {
+    out += ",\"error\":\"cannot resolve command\"";
+  }
+
+  out += '}';
+  tools::out << out << '\n';
+  return ok;
+}
+
+bool printResolved(Resolver &resolver, size_t line,
+                   const std::string &command) {
+  string_vector args;
+
+  if (splitCommandLine(command, args))
+    return args.empty() || printResolved(resolver, line, args);
+
+  std::string out;
+
+  err << "line " << line << ": unterminated quote or escape" << err.endl();
+
+  out = "{\"line\":";
+  out += std::to_string(line);
+  out += ",\"command\":";
+  putJSONString(out, command);
+  out += ",\"error\":\"cannot parse command line\"}";
+  tools::out << out << '\n';
+  return false;
+}
+
+//
+// osxcross-compdb
+//
+// Just enough JSON for compile_commands.json: entries are objects; the
+// values of keys other than "arguments", "command" and "directory" are
+// copied verbatim.
+//
+
+class JSONReader {
+public:
+  JSONReader(const std::string &data)
+      : p(data.c_str()), begin(p), end(p + data.size()) {}
+
+  void skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+      ++p;
+  }
+
+  bool consume(char c) {
+    skipSpace();
+
+    if (p == end || *p != c)
+      return false;
+
+    ++p;
+    return true;
+  }
+
+  bool peek(char c) {
+    skipSpace();
+    return p < end && *p == c;
+  }
+
+  bool atEnd() {
+    skipSpace();
+    return p == end;
+  }
+
+  bool readString(std::string &str) {
+    if (!consume('"'))
+      return false;
+
+    str.clear();
+
+    while (p < end && *p != '"') {
+      if (*p != '\\') {
+        str += *p++;
+        continue;
+      }
+
+      if (++p == end)
+        return false;
+
+      switch (*p++) {
+      case '"': str += '"'; break;
+      case '\\': str += '\\'; break;
+      case '/': str += '/'; break;
+      case 'b': str += '\b'; break;
+      case 'f': str += '\f'; break;
+      case 'n': str += '\n'; break;
+      case 'r': str += '\r'; break;
+      case 't': str += '\t'; break;
+      case 'u': {
+        unsigned long c;
+
+        if (!readHex(c))
+          return false;
+
+        // UTF-16 surrogate pair
+        if (c >= 0xD800 && c <= 0xDBFF && end - p >= 6 && p[0] == '\\' &&
+            p[1] == 'u') {
+          unsigned long low;
+          p += 2;
+
+          if (!readHex(low) || low < 0xDC00 || low > 0xDFFF)
+            return false;
+
+          c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        putUTF8(str, c);
+        break;
+      }
+      default:
+        return false;
+      }
+    }
+
+    return consume('"');
+  }
+
+  bool readStringArray(string_vector &v) {
+    std::string str;
+
+    if (!consume('['))
+      return false;
+
+    v.clear();
+
+    if (consume(']'))
+      return true;
+
+    do {
+      if (!readString(str))
+        return false;
+
+      v.push_back(str);
+    } while (consume(','));
+
+    return consume(']');
+  }
+
+  // Skips any value and returns its text.
+  bool readRaw(std::string &raw) {
+    skipSpace();
+    const char *start = p;
+
+    if (!skipValue())
+      return false;
+
+    raw.assign(start, p - start);
+    return true;
+  }
+
+  size_t offset() const { return p - begin; }
+
+private:
+  bool readHex(unsigned long &c) {
+    char buf[5];
+
+    if (end - p < 4)
+      return false;
+
+    memcpy(buf, p, 4);
+    buf[4] = '\0';
+
+    char *e;
+    c = strtoul(buf, &e, 16);
+    p += 4;
+
+    return e == buf + 4;
+  }
+
+  static void putUTF8(std::string &str, unsigned long c) {
+    if (c < 0x80) {
+      str += static_cast<char>(c);
+    } else if (c < 0x800) {
+      str += static_cast<char>(0xC0 | (c >> 6));
+      str += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+      str += static_cast<char>(0xE0 | (c >> 12));
+      str += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      str += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      str += static_cast<char>(0xF0 | (c >> 18));
+      str += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      str += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      str += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+
+  bool skipValue() {
+    std::string str;
+
+    skipSpace();
+
+    if (p == end)
+      return false;
+
+    switch (*p) {
+    case '"':
+      return readString(str);
+    case '[':
+    case '{': {
+      char close = *p == '[' ? ']' : '}';
+      ++p;
+
+      if (consume(close))
+        return true;
+
+      do {
+        if (close == '}' && (!readString(str) || !consume(':')))
+          return false;
+
+        if (!skipValue())
+          return false;
+      } while (consume(','));
+
+      return consume(close);
+    }
+    default: {
+      const char *start = p;
+
+      while (p < end && (isalnum(*p) || *p == '-' || *p == '+' || *p == '.'))
+        ++p;
+
+      return p != start;
+    }
+    }
+  }
+
+  const char *p;
+  const char *begin;
+  const char *end;
+};
+
+void compdbUsage() {
+  errout << "usage: osxcross-compdb [-o <output>] "
+         << "[<compile_commands.json>]\n";
+}
+
+// Rewrites 'args' of an entry to the command the wrapper would execute.
+// Entries of other compilers are kept as they are.
+bool rewriteEntry(Resolver &resolver, const std::string &directory,
+                  string_vector &args) {
+  const char *name = getFileName(args[0]);
+  Target target = resolver.newTarget();
+
+  // Only compiler names of this wrapper; others fail detection silently
+  // or are programs.
+  if (strncmp(name, "o32", 3) && strncmp(name, "o64", 3) &&
+      strncmp(name, "oa64", 4) && !strstr(name, "-apple-darwin"))
+    return false;
+
+  if (!directory.empty() && chdir(directory.c_str())) {
+    warn << "cannot enter directory '" << directory << "'" << warn.endl();
+    return false;
+  }
+
+  if (!resolver.resolve(args, target))
+    return false;
+
+  args.clear();
+  args.push_back(target.compilerpath);
+
+  // clang picks its driver mode (C / C++) from argv[0], which is
+  // compilerexecname when the wrapper executes it.
+  if (target.isClang() && endsWith(target.fargs[0], "++") &&
+      !endsWith(target.compilerpath, "++"))
+    args.push_back("--driver-mode=g++");
+
+  args.insert(args.end(), target.fargs.begin() + 1, target.fargs.end());
+  args.insert(args.end(), target.args.begin(), target.args.end());
+  return true;
+}
+
+} // anonymous namespace
+
+int resolve(int argc, char **argv, Target &target) {
+  bool readstdin = false;
+  char delimiter = '\n';
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+    if (!strcmp(argv[i], "--stdin")) {
+      readstdin = true;
+    } else if (!strcmp(argv[i], "-0") || !strcmp(argv[i], "--null")) {
+      delimiter = '\0';
+    } else {
+      resolveUsage();
+      return 1;
+    }
+  }
+
+  if (readstdin == (i < argc)) {
+    resolveUsage();
+    return 1;
+  }
+
+  Resolver resolver(target);
+
+  if (!readstdin)
+    return printResolved(resolver, 1, string_vector(argv + i, argv + argc))
+               ? 0
+               : 1;
+
+  std::string command;
+  size_t line = 0;
+  bool ok = true;
+  char *buf = nullptr;
+  size_t bufsize = 0;
+  ssize_t len;
+
+  while ((len = getdelim(&buf, &bufsize, delimiter, stdin)) != -1) {
+    if (len && buf[len - 1] == delimiter)
+      --len;
+
+    command.assign(buf, len);
+    ok &= printResolved(resolver, ++line, command);
+  }
+
+  free(buf);
+  return ok ? 0 : 1;
+}
+
+int compdb(int argc, char **argv, Target &target) {
+  const char *input = "compile_commands.json";
+  const char *output = nullptr;
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1]; ++i) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      compdbUsage();
+      return 1;
+    }
+  }
+
+  if (i < argc)
+    input = argv[i++];
+
+  if (i < argc) {
+    compdbUsage();
+    return 1;
+  }
+
+  std::string data;
+
+  if (!strcmp(input, "-")) {
+    if (!getFDContent(STDIN_FILENO, data)) {
+      err << "cannot read '<stdin>'" << err.endl();
+      return 1;
+    }
+  } else if (!getFileContent(input, data)) {
+    err << "cannot read '" << input << "'" << err.endl();
+    return 1;
+  }
+
+  char cwd[PATH_MAX + 1];
+
+  if (!getcwd(cwd, sizeof(cwd))) {
+    err << "cannot get the current working directory" << err.endl();
+    return 1;
+  }
+
+  Resolver resolver(target);
+  JSONReader reader(data);
+  std::string out;
+  size_t entries = 0;
+  size_t rewritten = 0;
+
+  auto parseError = [&]() {
+    err << "'" << input << "': invalid compilation database (at offset "
+        << reader.offset() << ")" << err.endl();
+    return 1;
+  };
+
+  if (!reader.consume('['))
+    return parseError();
+
+  out = "[";
+
+  while (!reader.peek(']')) {
+    // key, value (raw JSON) pairs in input order
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::string directory;
+    string_vector args;
+    size_t argsfield = 0;
+    std::string key;
+    std::string raw;
+
+    if (entries && !reader.consume(','))
+      return parseError();
+
+    if (!reader.consume('{'))
+      return parseError();
+
+    while (!reader.peek('}')) {
+      if (!fields.empty() && !reader.consume(','))
+        return parseError();
+
+      if (!reader.readString(key) || !reader.consume(':'))
+        return parseError();
+
+      if (key == "arguments") {
+        if (!reader.readStringArray(args))
+          return parseError();
+
+        argsfield = fields.size() + 1;
+        fields.push_back({key, ""});
+      } else if (key == "command") {
+        std::string command;
+
+        if (!reader.readString(command))
+          return parseError();
+
+        if (!splitCommandLine(command, args)) {
+          err << "'" << input << "': cannot split '" << command << "'"
+              << err.endl();
+          return 1;
+        }
+
+        argsfield = fields.size() + 1;
+        fields.push_back({key, ""});
+      } else {
+        if (!reader.readRaw(raw))
+          return parseError();
+
+        if (key == "directory") {
+          JSONReader value(raw);
+
+          if (!value.readString(directory))
+            return parseError();
+        }
+
+        fields.push_back({key, raw});
+      }
+    }
+
+    reader.consume('}');
+
+    if (!argsfield || args.empty())
+      return parseError();
+
+    if (rewriteEntry(resolver, directory, args))
+      ++rewritten;
+
+    out += entries++ ? ",\n{\n" : "\n{\n";
+
+    for (size_t f = 0; f < fields.size(); ++f) {
+      out += "  ";
+
+      if (f + 1 == argsfield) {
+        out += "\"arguments\": ";
+        putJSONArray(out, args);
+      } else {
+        putJSONString(out, fields[f].first);
+        out += ": ";
+        out += fields[f].second;
+      }
+
+      out += f + 1 < fields.size() ? ",\n" : "\n";
+    }
+
+    out += '}';
+  }
+
+  if (!reader.consume(']') || !reader.atEnd())
+    return parseError();
+
+  out += "\n]\n";
+
+  if (chdir(cwd))
+    return 1;
+
+  if (output ? !writeFileContentAtomic(output, out)
+             : !(tools::out << out).flush()) {
+    err << "cannot write '" << (output ? output : "<stdout>") << "'"
+        << err.endl();
+    return 1;
+  }
+
+  info << rewritten << " of " << entries << " entries rewritten"
+       << info.endl();
+
+  return 0;
+}
+
+} // namespace osxcross
+} // namespace program
@@ -27,8 +27,85 @@ using namespace target;
 namespace program {
 namespace osxcross {
 
-int version() {
-  std::cout << "version: " << getOSXCrossVersion() << std::endl;
+namespace {
+
+// A hash of everything the toolchain's output depends on. The hashes of the
+// compiler binary and the SDK are looked up in the manifest, which
+// osxcross-manifest fills at install time. Entries are only used while the
+// stamps of every file below the path are unchanged.
+int fingerprint(Target &target) {
+  string_vector paths;
+  hash_type hash = FNV1aBasis;
+
+  if (!getFingerprintPaths(target, paths))
+    return 1;
+
+  hash = hashString(getOSXCrossVersion(), hash);
+  hash = hashString(getBuildFlavor(), hash);
+  hash = hashString(getDefaultTarget(), hash);
+  hash = hashString(getSupportedArchsString(), hash);
+
+  for (auto &path : paths) {
+    std::string value;
+    std::string stamps;
+    hash_type content;
+
+    if (!::manifest::lookup(::manifest::Fingerprint, path.c_str(), value,
+                            &stamps) ||
+        !hashFileTreeStamps(path, content) ||
+        hashToString(content) != stamps) {
+
+      if (debug)
+        dbg << "fingerprint: hashing '" << path << "'" << dbg.endl();
+
+      if (!hashFileTree(path, content)) {
+        err << "cannot read '" << path << "'" << err.endl();
+        return 1;
+      }
+
+      value = hashToString(content);
+    }
+
+    hash = hashString(value, hash);
+  }
+
+  out << hashToString(hash) << '\n';
+  return 0;
+}
+
+} // anonymous namespace
+
+// The default compiler (resolved) and the SDK.
+bool getFingerprintPaths(Target &target, string_vector &paths) {
+  std::string SDKPath;
+
+  target.compiler = getDefaultCompilerIdentifier();
+  target.compilername = getDefaultCompilerName();
+  target.setCompilerPath();
+
+  char *compiler = realpath(target.compilerpath.c_str(), nullptr);
+
+  if (!compiler) {
+    err << "cannot find '" << target.compilername << "'" << err.endl();
+    return false;
+  }
+
+  paths.clear();
+  paths.push_back(compiler);
+  free(compiler);
+
+  if (!target.getSDKPath(SDKPath))
+    return false;
+
+  paths.push_back(SDKPath);
+  return true;
+}
+
+int version(int argc, char **argv, Target &target) {
+  if (argc > 1 && !strcmp(argv[1], "--fingerprint"))
+    return fingerprint(target);
+
+  out << "version: " << getOSXCrossVersion() << '\n';
   return 0;
 }
 
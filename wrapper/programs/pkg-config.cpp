@@ -110,7 +110,7 @@ int pkg_config(int argc, char **argv, Target &target) {
     if (!getenv("PKG_CONFIG_LIBDIR"))
       setenv("PKG_CONFIG_LIBDIR", "", 1);
 
-    execvp("pkg-config", argv);
+    manifest::execTool("pkg-config", argv);
     err << "cannot find or execute pkg-config" << err.endl();
     return 1;
   }
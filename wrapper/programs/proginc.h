@@ -1,10 +1,10 @@
 #include "compat.h"
 
 #include <vector>
+#include <string>
 #include <algorithm>
-#include <iostream>
-#include <sstream>
 #include <cstdlib>
+#include <cstdio>
 #include <cstring>
 #include <climits>
 #include <cassert>
@@ -13,6 +13,8 @@
 #include "tools.h"
 #include "target.h"
 #include "progs.h"
+#include "manifest.h"
+#include "trace.h"
 
 extern int debug;
 extern int unittest;
@@ -47,23 +47,23 @@ int sw_vers(int argc, char **argv, Target &target) {
   };
 
   if (argc == 2) {
-    std::stringstream str;
+    std::string str;
 
     if (!strcmp(argv[1], "-productName")) {
-      str << "Mac OS X";
+      str = "Mac OS X";
     } else if (!strcmp(argv[1], "-productVersion")) {
-      str << getProductVer().shortStr();
+      str = getProductVer().shortStr();
     } else if (!strcmp(argv[1], "-buildVersion")) {
-      str << "0CFFFF";
+      str = "0CFFFF";
     } else {
       return 1;
     }
 
-    std::cout << str.str() << std::endl;
+    out << str << '\n';
   } else if (argc == 1) {
-    std::cout << "ProductName:    Mac OS X" << std::endl;
-    std::cout << "ProductVersion: " << getProductVer().shortStr() << std::endl;
-    std::cout << "BuildVersion:   0CFFFF" << std::endl;
+    out << "ProductName:    Mac OS X" << '\n';
+    out << "ProductVersion: " << getProductVer().shortStr() << '\n';
+    out << "BuildVersion:   0CFFFF" << '\n';
   }
 
   return 0;
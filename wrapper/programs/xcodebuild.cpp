@@ -28,13 +28,13 @@ namespace program {
 namespace {
 
 int version(Target*, char**) {
-  std::cout << "Xcode 11.0.0" << std::endl;
-  std::cout << "Build version 0CFFFF" << std::endl;
+  out << "Xcode 11.0.0" << '\n';
+  out << "Build version 0CFFFF" << '\n';
   return 0;
 }
 
 int help(Target* = nullptr, char** = nullptr) {
-  std::cerr << "Only '-version' is supported by this stub tool" << std::endl;
+  errout << "Only '-version' is supported by this stub tool" << '\n';
   return 0;
 }
 
@@ -31,22 +31,8 @@ bool isStandaloneXcrun = false;
 bool showCommand = false;
 
 bool isXcodeTool(const char *tool) {
-  constexpr const char *XcodeTools[] = {
-    "ar", "as", "c89", "c99", "c11", "c++", "cc", "checksyms", "clang",
-    "clang++", "dsymutil", "codesign_allocate", "dyldinfo", "gcc", "g++",
-    "gcov", "gprof", "indr", "install_name_tool", "ld", "libtool", "lipo",
-    "machocheck", "nm", "nmedit", "ObjectDump", "objdump", "otool",
-    "pagestuff", "pkg-config", "ranlib", "redo_prebinding",
-    "seg_addr_table", "seg_hack", "size", "strings", "strip", "sw_vers",
-    "unwinddump", "xcodebuild", "xcrun", "bitcode_strip",
-    "vtool", "makerelocs", "mtoc", "mtor"
-  };
-
-  for (const char *xctool : XcodeTools)
-    if (!strcmp(tool, xctool))
-      return true;
-
-  return false;
+  const program::prog *p = program::findprog(tool);
+  return p && p->isXcodeTool();
 }
 
 bool getToolPath(Target *target, std::string &toolpath, std::string tool) {
@@ -101,13 +87,13 @@ bool getToolPath(Target *target, std::string &toolpath, std::string tool) {
 }
 
 int help(Target* = nullptr, char** = nullptr) {
-  std::cerr << "https://developer.apple.com/library/mac/documentation/Darwin/"
-               "Reference/ManPages/man1/xcrun.1.html" << std::endl;
+  errout << "https://developer.apple.com/library/mac/documentation/Darwin/"
+            "Reference/ManPages/man1/xcrun.1.html" << '\n';
   return 0;
 }
 
 int version(Target*, char**) {
-  std::cout << "xcrun version: 0." << std::endl;
+  out << "xcrun version: 0." << '\n';
   return 0;
 }
 
@@ -161,7 +147,7 @@ int find(Target *target, char **argv) {
   std::string toolpath;
   if (!getToolPath(target, toolpath, toolname))
     return 1;
-  std::cout << toolpath << std::endl;
+  out << toolpath << '\n';
   return 0;
 }
 
@@ -184,13 +170,14 @@ int run(Target *target, char **argv) {
 
   if (showCommand) {
     for (size_t i = 0; i < args.size() - 1; ++i) {
-      std::cout << args[i];
+      out << args[i];
       if (i != args.size() - 2)
-        std::cout << " ";
+        out << " ";
     }
-    std::cout << std::endl;
+    out << '\n';
   }
 
+  trace::exec(args[0]);
   execvp(args[0], args.data());
   err << "xcrun: cannot execute '" << args[0] << "'" << err.endl();
   exit(1);
@@ -204,17 +191,17 @@ int showSDKPath(Target *target, char**) {
   std::string SDKPath;
   if (!target->getSDKPath(SDKPath))
     return 1;
-  std::cout << SDKPath << std::endl;
+  out << SDKPath << '\n';
   return 0;
 }
 
 int showSDKVersion(Target *target, char**) {
-  std::cout << target->getSDKOSNum().shortStr() << std::endl;
+  out << target->getSDKOSNum().shortStr() << '\n';
   return 0;
 }
 
 int showPlatformPath(Target *target, char**) {
-  std::cout << target->execpath << "/.." << std::endl;
+  out << target->execpath << "/.." << '\n';
   return 0;
 }
 
@@ -14,7 +14,7 @@ int executeExternalTool(const char *toolName, int argc, char **argv) {
     args.push_back(argv[i]);
 
   args.push_back(nullptr);
-  execvp(toolName, args.data());
+  manifest::execTool(toolName, args.data());
 
   err << "Error: cannot execute '" << toolName << "'" << err.endl();
   return 1;
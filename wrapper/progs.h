@@ -28,8 +28,20 @@ namespace program {
 using target::Target;
 
 int executeExternalTool(const char *toolName, int argc, char **argv);
+// Runs the wrapper's compiler code path as if the wrapper had been invoked
+// as argv[0] (driver.cpp).
+int executeCompiler(int argc, char **argv);
+// Resolves the compiler invocation argv (fargs, args, compilerpath) without
+// running it; never executes programs. Reuses setup() results of earlier
+// calls (driver.cpp).
+bool resolveCompiler(int argc, char **argv, Target &target);
 void printExternalToolArgs(int argc, char **argv, std::vector<char *> &args);
 
+// Flags of programs[] entries
+enum : int {
+  XcodeTool = 1 // shipped with Xcode; looked up by xcrun
+};
+
 class prog {
 public:
   typedef int (*f1)();
@@ -37,20 +49,24 @@ public:
   typedef int (*f3)(int, char **, Target &);
   typedef int (*f4)(Target &);
 
-  constexpr prog(const char *name, f1 fun)
-      : name(name), fun1(fun), tool(nullptr), type(1) {}
+  constexpr prog(const char *name, f1 fun, int flags = 0)
+      : name(name), fun1(fun), tool(nullptr), type(1), flags(flags) {}
+
+  constexpr prog(const char *name, f2 fun, int flags = 0)
+      : name(name), fun2(fun), tool(nullptr), type(2), flags(flags) {}
 
-  constexpr prog(const char *name, f2 fun)
-      : name(name), fun2(fun), tool(nullptr), type(2) {}
+  constexpr prog(const char *name, f3 fun, int flags = 0)
+      : name(name), fun3(fun), tool(nullptr), type(3), flags(flags) {}
 
-  constexpr prog(const char *name, f3 fun)
-      : name(name), fun3(fun), tool(nullptr), type(3) {}
+  constexpr prog(const char *name, f4 fun, int flags = 0)
+      : name(name), fun4(fun), tool(nullptr), type(4), flags(flags) {}
 
-  constexpr prog(const char *name, f4 fun)
-      : name(name), fun4(fun), tool(nullptr), type(4) {}
+  constexpr prog(const char *name, const char *tool, int flags = 0)
+      : name(name), fun1(nullptr), tool(tool), type(5), flags(flags) {}
 
-  constexpr prog(const char *name, const char *tool)
-      : name(name), fun1(nullptr), tool(tool), type(5) {}
+  // Name only; not a program of the wrapper.
+  constexpr prog(const char *name, int flags)
+      : name(name), fun1(nullptr), tool(nullptr), type(0), flags(flags) {}
 
   __attribute__((noreturn))
   void operator()(int argc, char **argv, Target &target) const {
@@ -79,6 +95,12 @@ public:
     return name == this->name;
   }
 
+  // Returns the external tool for entries that are plain aliases.
+  const char *getTool() const { return type == 5 ? tool : nullptr; }
+
+  bool isProgram() const { return type != 0; }
+  bool isXcodeTool() const { return flags & XcodeTool; }
+
   const char *name;
 
 private:
@@ -91,6 +113,7 @@ private:
 
   const char *tool;
   int type;
+  int flags;
 };
 
 int sw_vers(int argc, char **argv, target::Target &target);
@@ -107,77 +130,142 @@ int as(int argc, char **argv, Target &target);
 } // namespace llvm
 
 namespace osxcross {
-int version();
+int version(int argc, char **argv, Target &target);
+bool getFingerprintPaths(Target &target, tools::string_vector &paths);
+int cache(int argc, char **argv);
 int env(int argc, char **argv);
 int conf(Target &target);
+int manifest(Target &target);
+int pack_toolchain(int argc, char **argv, Target &target);
+int resolve(int argc, char **argv, Target &target);
+int compdb(int argc, char **argv, Target &target);
 int man(int argc, char **argv, Target &target);
 int pkg_config(int argc, char **argv, Target &target);
 } // namespace osxcross
 
 static int dummy() { return 0; }
 
+// The single list of tool names the wrapper knows about: its programs and
+// the tools shipped with Xcode (xcrun). Must be sorted by name (strcmp()),
+// which is verified at compile time.
 constexpr prog programs[] = {
-  // Built-in tools
-  { "sw_vers",          sw_vers },
-  { "xcrun",            xcrun },
-  { "xcodebuild",       xcodebuild },
-
-  // LLVM tools
-
-  // These are LLVM tools where we must modify the passed arguments to it.
-  { "ld",               llvm::ld },
-  { "lipo",             llvm::lipo },
-  { "as",               llvm::clang::as },
-
-  // Used 'as-is', besides making them believe
-  // they are invoked as "llvm-<tool>" instead of "<tool>".
-  { "otool",            "llvm-otool" },
-
-  { "nm",               "llvm-nm" },
-  { "ar",               "llvm-ar" },
-  { "libtool",          "llvm-libtool-darwin" },
-  { "install_name_tool","llvm-install-name-tool" },
-  { "ranlib",           "llvm-ranlib" },
-  { "readtapi",         "llvm-readtapi" },
-  { "objdump",          "llvm-objdump" },
-  { "strip",            "llvm-strip" },
-  { "strings",          "llvm-strings" },
-  { "size",             "llvm-size" },
-  { "symbolizer",       "llvm-symbolizer" },
-  { "cov",              "llvm-cov" },
-  { "profdata",         "llvm-profdata" },
-  { "readobj",          "llvm-readobj" },
-  { "readelf",          "llvm-readelf" },
-  { "dwarfdump",        "llvm-dwarfdump" },
-  { "cxxfilt",          "llvm-cxxfilt" },
-  { "objcopy",          "llvm-objcopy" },
-  { "config",           "llvm-config" },
-  { "dis",              "llvm-dis" },
-  { "link",             "llvm-link" },
-  { "lto",              "llvm-lto" },
-  { "lto2",             "llvm-lto2" },
-  { "bcanalyzer",       "llvm-bcanalyzer" },
-  { "bitcode_strip",    "llvm-bitcode-strip" },
-
-  // OSXCross tools
-  { "osxcross",         osxcross::version },
-  { "osxcross-env",     osxcross::env },
-  { "osxcross-conf",    osxcross::conf },
-
-  // Tools where we must modify the passed arguments to it.
-  { "osxcross-man",     osxcross::man },
-  { "pkg-config",       osxcross::pkg_config },
-
-  // Dummy tool. No-op.
-  { "wrapper",          dummy }
+  { "ObjectDump",         XcodeTool },
+  { "ar",                 "llvm-ar", XcodeTool },
+  { "as",                 llvm::clang::as, XcodeTool },
+  { "bcanalyzer",         "llvm-bcanalyzer" },
+  { "bitcode_strip",      "llvm-bitcode-strip", XcodeTool },
+  { "c++",                XcodeTool },
+  { "c11",                XcodeTool },
+  { "c89",                XcodeTool },
+  { "c99",                XcodeTool },
+  { "cc",                 XcodeTool },
+  { "checksyms",          XcodeTool },
+  { "clang",              XcodeTool },
+  { "clang++",            XcodeTool },
+  { "codesign_allocate",  XcodeTool },
+  { "config",             "llvm-config" },
+  { "cov",                "llvm-cov" },
+  { "cxxfilt",            "llvm-cxxfilt" },
+  { "dis",                "llvm-dis" },
+  { "dsymutil",           XcodeTool },
+  { "dwarfdump",          "llvm-dwarfdump" },
+  { "dyldinfo",           XcodeTool },
+  { "g++",                XcodeTool },
+  { "gcc",                XcodeTool },
+  { "gcov",               XcodeTool },
+  { "gprof",              XcodeTool },
+  { "indr",               XcodeTool },
+  { "install_name_tool",  "llvm-install-name-tool", XcodeTool },
+  { "ld",                 llvm::ld, XcodeTool },
+  { "libtool",            "llvm-libtool-darwin", XcodeTool },
+  { "link",               "llvm-link" },
+  { "lipo",               llvm::lipo, XcodeTool },
+  { "lto",                "llvm-lto" },
+  { "lto2",               "llvm-lto2" },
+  { "machocheck",         XcodeTool },
+  { "makerelocs",         XcodeTool },
+  { "mtoc",               XcodeTool },
+  { "mtor",               XcodeTool },
+  { "nm",                 "llvm-nm", XcodeTool },
+  { "nmedit",             XcodeTool },
+  { "objcopy",            "llvm-objcopy" },
+  { "objdump",            "llvm-objdump", XcodeTool },
+  { "osxcross",           osxcross::version },
+  { "osxcross-cache",     osxcross::cache },
+  { "osxcross-compdb",    osxcross::compdb },
+  { "osxcross-conf",      osxcross::conf },
+  { "osxcross-env",       osxcross::env },
+  { "osxcross-man",       osxcross::man },
+  { "osxcross-manifest",  osxcross::manifest },
+  { "osxcross-pack-toolchain", osxcross::pack_toolchain },
+  { "osxcross-resolve",   osxcross::resolve },
+  { "otool",              "llvm-otool", XcodeTool },
+  { "pagestuff",          XcodeTool },
+  { "pkg-config",         osxcross::pkg_config, XcodeTool },
+  { "profdata",           "llvm-profdata" },
+  { "ranlib",             "llvm-ranlib", XcodeTool },
+  { "readelf",            "llvm-readelf" },
+  { "readobj",            "llvm-readobj" },
+  { "readtapi",           "llvm-readtapi" },
+  { "redo_prebinding",    XcodeTool },
+  { "seg_addr_table",     XcodeTool },
+  { "seg_hack",           XcodeTool },
+  { "size",               "llvm-size", XcodeTool },
+  { "strings",            "llvm-strings", XcodeTool },
+  { "strip",              "llvm-strip", XcodeTool },
+  { "sw_vers",            sw_vers, XcodeTool },
+  { "symbolizer",         "llvm-symbolizer" },
+  { "unwinddump",         XcodeTool },
+  { "vtool",              XcodeTool },
+  { "wrapper",            dummy }, // no-op
+  { "xcodebuild",         xcodebuild, XcodeTool },
+  { "xcrun",              xcrun, XcodeTool }
 };
 
-template <class T> const prog *getprog(const T &name) {
-  for (auto &p : programs) {
-    if (p == name)
-      return &p;
+constexpr size_t numPrograms = sizeof(programs) / sizeof(programs[0]);
+
+constexpr int constexprStrCmp(const char *a, const char *b) {
+  return *a != *b || !*a ? static_cast<unsigned char>(*a) -
+                               static_cast<unsigned char>(*b)
+                         : constexprStrCmp(a + 1, b + 1);
+}
+
+constexpr bool isSorted(const prog *p, size_t n) {
+  return n < 2 ||
+         (constexprStrCmp(p[0].name, p[1].name) < 0 && isSorted(p + 1, n - 1));
+}
+
+static_assert(isSorted(programs, numPrograms),
+              "programs[] must be sorted by name");
+
+// Binary search over programs[]; includes name only entries.
+inline const prog *findprog(const char *name) {
+  size_t lo = 0;
+  size_t hi = numPrograms;
+
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int cmp = strcmp(name, programs[mid].name);
+
+    if (!cmp)
+      return &programs[mid];
+
+    if (cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
   }
+
   return nullptr;
 }
 
+inline const prog *getprog(const char *name) {
+  const prog *p = findprog(name);
+  return p && p->isProgram() ? p : nullptr;
+}
+
+inline const prog *getprog(const std::string &name) {
+  return getprog(name.c_str());
+}
+
 } // namespace program
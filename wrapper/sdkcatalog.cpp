@@ -0,0 +1,259 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <climits>
+#include <sys/stat.h>
+
+#include "tools.h"
+#include "sdkcatalog.h"
+#include "trace.h"
+
+extern int debug;
+
+namespace sdkcatalog {
+
+using namespace tools;
+
+namespace {
+
+constexpr const char *CatalogMagic = "osxcross-sdk-catalog-1";
+
+// Like std::getline() on the content, starting at pos.
+bool getLine(const std::string &content, size_t &pos, std::string &line) {
+  if (pos >= content.size())
+    return false;
+
+  size_t end = content.find('\n', pos);
+
+  if (end == std::string::npos)
+    end = content.size();
+
+  line.assign(content, pos, end - pos);
+  pos = end + 1;
+  return true;
+}
+
+void split(const std::string &line, string_vector &fields) {
+  size_t begin = 0;
+  size_t end;
+
+  fields.clear();
+
+  while ((end = line.find('\t', begin)) != std::string::npos) {
+    fields.push_back(line.substr(begin, end - begin));
+    begin = end + 1;
+  }
+
+  fields.push_back(line.substr(begin));
+}
+
+bool load(const std::string &file, const std::string &stamp,
+          Catalog &catalog) {
+  std::string content;
+
+  if (!getFileContent(file, content))
+    return false;
+
+  size_t pos = 0;
+  std::string line;
+  string_vector fields;
+
+  if (!getLine(content, pos, line) || line != CatalogMagic)
+    return false;
+
+  if (!getLine(content, pos, line) || line != "stamp\t" + stamp)
+    return false;
+
+  catalog = Catalog();
+
+  while (getLine(content, pos, line)) {
+    split(line, fields);
+
+    if (fields[0] == "default" && fields.size() == 3) {
+      catalog.defaultSDK = static_cast<DefaultSDK>(atoi(fields[1].c_str()));
+      catalog.defaultSDKPath = fields[2];
+    } else if (fields[0] == "sdk" && fields.size() == 4) {
+      SDK entry;
+      entry.name = fields[1];
+      entry.version = parseOSVersion(fields[2].c_str());
+      entry.defaultDeploymentTarget = parseOSVersion(fields[3].c_str());
+      catalog.SDKs.push_back(entry);
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void store(const std::string &file, const std::string &stamp,
+           const Catalog &catalog) {
+  std::string content;
+
+  content += CatalogMagic;
+  content += "\nstamp\t";
+  content += stamp;
+  content += "\ndefault\t";
+  content += static_cast<char>('0' + catalog.defaultSDK);
+  content += '\t';
+  content += catalog.defaultSDKPath;
+  content += '\n';
+
+  for (auto &SDK : catalog.SDKs) {
+    content += "sdk\t";
+    content += SDK.name;
+    content += '\t';
+    content += SDK.version.Str();
+    content += '\t';
+    content += SDK.defaultDeploymentTarget.Str();
+    content += '\n';
+  }
+
+  if (!writeFileContentAtomic(file, content) && debug)
+    dbg << "cannot write SDK catalog '" << file << "'" << dbg.endl();
+}
+
+void scan(const char *SDKSearchDir, Catalog &catalog) {
+  std::string defaultSDKPath = SDKSearchDir;
+  struct stat st;
+
+  defaultSDKPath += PATHDIV;
+  defaultSDKPath += "default";
+
+  catalog = Catalog();
+
+  trace::Probe probe("lstat", defaultSDKPath.c_str());
+
+  if (probe(!lstat(defaultSDKPath.c_str(), &st))) {
+    if (!S_ISLNK(st.st_mode)) {
+      catalog.defaultSDK = notlink;
+    } else {
+      trace::Probe probe("realpath", defaultSDKPath.c_str());
+      char *resolved = realpath(defaultSDKPath.c_str(), nullptr);
+
+      if (probe(resolved != nullptr)) {
+        catalog.defaultSDK = symlink;
+        catalog.defaultSDKPath = resolved;
+        free(resolved);
+      } else {
+        catalog.defaultSDK = broken;
+      }
+    }
+  }
+
+  static string_vector names;
+  names.clear();
+
+  listFiles(SDKSearchDir, nullptr, [](const char *SDK) {
+    if (!strncasecmp(SDK, "MacOSX", 6))
+      names.push_back(SDK);
+    return false;
+  });
+
+  for (auto &name : names) {
+    SDK entry;
+    entry.name = name;
+    entry.version = parseOSVersion(name.c_str() + 6);
+    entry.defaultDeploymentTarget =
+        readDefaultDeploymentTarget(std::string(SDKSearchDir) + PATHDIV + name);
+    catalog.SDKs.push_back(entry);
+  }
+}
+
+} // anonymous namespace
+
+const SDK *Catalog::getLatestSDK() const {
+  const SDK *latest = nullptr;
+
+  for (auto &SDK : SDKs) {
+    if (SDK.version > (latest ? latest->version : OSVersion()))
+      latest = &SDK;
+  }
+
+  return latest;
+}
+
+bool getCatalog(const char *SDKSearchDir, Catalog &catalog) {
+  std::string dir = SDKSearchDir;
+  std::string file;
+  std::string stamp;
+
+  dir += "/.osxcross";
+  file = dir + "/sdk-catalog";
+
+  getFileStamp(SDKSearchDir, stamp);
+
+  if (stamp == "missing")
+    return false;
+
+  if (load(file, stamp, catalog))
+    return true;
+
+  if (debug >= 2)
+    dbg << "rebuilding SDK catalog for '" << SDKSearchDir << "'"
+        << dbg.endl();
+
+  // Creating the subdirectory changes the modification time of the search
+  // directory, files created within it do not. The stamp is taken before
+  // scanning: SDKs that come and go in between invalidate the catalog.
+  bool writable = createDirectory(dir);
+
+  if (writable)
+    getFileStamp(SDKSearchDir, stamp);
+
+  scan(SDKSearchDir, catalog);
+
+  if (writable)
+    store(file, stamp, catalog);
+
+  return true;
+}
+
+// Reads "DefaultDeploymentTarget" from SDKSettings.json.
+OSVersion readDefaultDeploymentTarget(const std::string &SDKPath) {
+  constexpr const char *Key = "\"DefaultDeploymentTarget\"";
+  std::string content;
+
+  if (!getFileContent(SDKPath + "/SDKSettings.json", content))
+    return OSVersion();
+
+  size_t pos = content.find(Key);
+
+  if (pos == std::string::npos)
+    return OSVersion();
+
+  pos = content.find('"', content.find(':', pos + strlen(Key)));
+
+  if (pos == std::string::npos)
+    return OSVersion();
+
+  return parseOSVersion(content.c_str() + pos + 1);
+}
+
+} // namespace sdkcatalog
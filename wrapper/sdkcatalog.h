@@ -0,0 +1,59 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace sdkcatalog {
+
+using tools::OSVersion;
+
+//
+// SDK catalog for 'OSXCROSS_SDK_SEARCH_DIR'
+//
+// Picking the SDK from the search directory requires resolving 'default'
+// or listing the directory. The result is stored in
+// <search dir>/.osxcross/sdk-catalog and reused until the modification
+// time of the search directory changes.
+//
+
+enum DefaultSDK {
+  none,    // no 'default' entry
+  symlink, // 'default' -> SDK (resolved)
+  notlink, // 'default' is not a symlink
+  broken   // 'default' is a broken symlink
+};
+
+struct SDK {
+  std::string name;                // MacOSX<version>.sdk
+  OSVersion version;
+  OSVersion defaultDeploymentTarget; // from SDKSettings.json; may be unset
+};
+
+struct Catalog {
+  DefaultSDK defaultSDK;
+  std::string defaultSDKPath;
+  std::vector<SDK> SDKs;
+
+  const SDK *getLatestSDK() const;
+};
+
+bool getCatalog(const char *SDKSearchDir, Catalog &catalog);
+OSVersion readDefaultDeploymentTarget(const std::string &SDKPath);
+
+} // namespace sdkcatalog
@@ -0,0 +1,454 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "tools.h"
+#include "target.h"
+#include "trace.h"
+#include "driver.h"
+#include "sdkpch.h"
+
+extern int debug;
+
+namespace sdkpch {
+
+using namespace tools;
+using target::DriverMode;
+
+namespace {
+
+constexpr const char SDKPCHMagic[] = "osxcross-sdk-pch-1";
+
+constexpr const char *UmbrellaHeaders[] = {
+  "AppKit/AppKit.h", "ApplicationServices/ApplicationServices.h",
+  "Cocoa/Cocoa.h", "CoreFoundation/CoreFoundation.h",
+  "CoreGraphics/CoreGraphics.h", "CoreServices/CoreServices.h",
+  "Foundation/Foundation.h", "Metal/Metal.h", "QuartzCore/QuartzCore.h"
+};
+
+// Umbrella headers are expected at the very top of a source file.
+constexpr size_t MaxPrefixSize = 16384;
+
+bool startsWith(const std::string &str, const char *prefix) {
+  return !str.compare(0, strlen(prefix), prefix);
+}
+
+// Invocations with inputs or outputs a shared PCH would interfere with.
+bool isIncompatible(const std::string &arg) {
+  constexpr const char *Options[] = {
+    "-include", "-imacros", "-emit-pch", "-fmodules", "-save-temps",
+    "-x"
+  };
+
+  for (const char *opt : Options) {
+    if (startsWith(arg, opt))
+      return true;
+  }
+
+  return false;
+}
+
+bool isDependencyOption(const std::string &arg) {
+  return arg == "-MD" || arg == "-MMD" || arg == "-MP" ||
+         startsWith(arg, "-MF") || startsWith(arg, "-MT") ||
+         startsWith(arg, "-MQ");
+}
+
+// Header search options; relative ones make the PCH depend on the
+// working directory.
+bool isSearchPathOption(const std::string &arg, size_t &len) {
+  constexpr const char *Options[] = {
+    "-isystem", "-cxx-isystem", "-icxx-isystem", "-idirafter",
+    "-iframework", "-I", "-F"
+  };
+
+  for (const char *opt : Options) {
+    if (startsWith(arg, opt)) {
+      len = strlen(opt);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// The language of the PCH, from the extension of the source file.
+const char *getLanguage(const char *file) {
+  const char *ext = getFileExtension(file);
+
+  if (!strcmp(ext, ".m"))
+    return "objective-c";
+
+  if (!strcmp(ext, ".mm") || !strcmp(ext, ".M"))
+    return "objective-c++";
+
+  if (!strcmp(ext, ".c"))
+    return "c";
+
+  if (!strcmp(ext, ".cc") || !strcmp(ext, ".cpp") || !strcmp(ext, ".cxx") ||
+      !strcmp(ext, ".c++") || !strcmp(ext, ".C"))
+    return "c++";
+
+  return nullptr;
+}
+
+// The single source file of the invocation.
+bool getSourceFile(const Target &target, std::string &source) {
+  const string_vector &args = target.args;
+  size_t inputs = 0;
+
+  for (size_t i = 0; i < args.size(); ++i) {
+    const char *arg = args[i].c_str();
+
+    if (*arg != '-' || !arg[1]) {
+      source = arg;
+      ++inputs;
+    } else if (driver::takesSeparateValue(arg)) {
+      ++i;
+    }
+  }
+
+  return inputs == 1 && source != "-";
+}
+
+// The leading #import / #include directives of 'file' that name umbrella
+// headers, as the content of the header to precompile. Whitespace and
+// comments may precede them; anything else ends the prefix.
+bool getUmbrellaPrefix(const std::string &file, std::string &prefix) {
+  char buf[MaxPrefixSize];
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+  prefix.clear();
+
+  if (fd == -1)
+    return false;
+
+  ssize_t len = read(fd, buf, sizeof(buf));
+  close(fd);
+
+  if (len <= 0)
+    return false;
+
+  const char *p = buf;
+  const char *end = buf + len;
+
+  auto skipBlanks = [&]() {
+    while (p < end && (*p == ' ' || *p == '\t'))
+      ++p;
+  };
+
+  auto skipLine = [&]() {
+    while (p < end && *p != '\n')
+      ++p;
+  };
+
+  auto at = [&](const char *str) {
+    size_t n = strlen(str);
+    return size_t(end - p) >= n && !memcmp(p, str, n);
+  };
+
+  while (p < end) {
+    if (isspace(static_cast<unsigned char>(*p))) {
+      ++p;
+    } else if (at("//")) {
+      skipLine();
+    } else if (at("/*")) {
+      const char *close = nullptr;
+
+      for (const char *c = p + 2; c + 1 < end; ++c) {
+        if (c[0] == '*' && c[1] == '/') {
+          close = c;
+          break;
+        }
+      }
+
+      if (!close)
+        break;
+
+      p = close + 2;
+    } else if (*p == '#') {
+      ++p;
+      skipBlanks();
+
+      const char *directive = at("import") ? "import"
+                              : at("include") ? "include" : nullptr;
+
+      if (!directive)
+        break;
+
+      p += strlen(directive);
+      skipBlanks();
+
+      if (p >= end || *p != '<')
+        break;
+
+      const char *name = ++p;
+
+      while (p < end && *p != '>' && *p != '\n')
+        ++p;
+
+      if (p >= end || *p != '>')
+        break;
+
+      std::string header(name, p - name);
+      bool umbrella = false;
+
+      for (const char *h : UmbrellaHeaders)
+        umbrella |= header == h;
+
+      ++p;
+      skipBlanks();
+
+      // Nothing but a line comment may follow.
+      if (!umbrella || (p < end && *p != '\n' && *p != '\r' && !at("//")))
+        break;
+
+      skipLine();
+
+      prefix += '#';
+      prefix += directive;
+      prefix += " <";
+      prefix += header;
+      prefix += ">\n";
+    } else {
+      break;
+    }
+  }
+
+  return !prefix.empty();
+}
+
+void addKey(hash_type &hash, const std::string &value) {
+  hash = hashData(value.c_str(), value.size() + 1, hash);
+}
+
+// Builds 'pch' from 'header' unless another invocation has done so (or
+// has failed to) in the meantime.
+bool build(const std::string &compiler, string_vector &cmd,
+           const std::string &header, const std::string &prefix,
+           const std::string &pch) {
+  trace::Span span("sdkpch: build");
+  const std::string lock = pch + ".lock";
+  const std::string failed = pch + ".failed";
+  int fd = open(lock.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+
+  if (fd == -1 || flock(fd, LOCK_EX)) {
+    if (fd != -1)
+      close(fd);
+    return false;
+  }
+
+  bool ok = fileExists(pch);
+
+  if (!ok && !fileExists(failed)) {
+    std::string tmp = pch + ".tmp." + std::to_string(getpid());
+    std::string log;
+    FILE *logfile = tmpfile();
+    int rc = -1;
+
+    cmd.push_back(tmp);
+
+    // The PCH records the header's stamp; it must not change afterwards.
+    if (logfile && writeFileContent(header, prefix)) {
+      pid_t pid = spawnProcess(compiler, cmd, fileno(logfile),
+                               fileno(logfile));
+
+      if (pid != -1)
+        rc = waitProcess(pid);
+    }
+
+    if (logfile) {
+      rewind(logfile);
+      getFDContent(fileno(logfile), log);
+      fclose(logfile);
+
+      if (!log.empty() && log.back() == '\n')
+        log.pop_back();
+    }
+
+    ok = !rc && !rename(tmp.c_str(), pch.c_str());
+
+    if (ok) {
+      if (debug >= 2)
+        dbg << "sdk pch: built '" << pch << "'" << dbg.endl();
+    } else {
+      unlink(tmp.c_str());
+
+      // Only the compiler rejecting the header is permanent. Failing to
+      // start it (fork(), 127 from exec), signals (Ctrl-C), I/O errors and
+      // the like are retried next time.
+      if (rc > 0 && rc < 126 && writeFileContent(failed, log))
+        warn << "cannot precompile SDK headers, see '" << failed << "'"
+             << warn.endl();
+
+      if (debug)
+        dbg << "sdk pch: building '" << pch << "' failed (" << rc
+            << "):\n" << log << dbg.endl();
+    }
+  }
+
+  close(fd);
+  return ok;
+}
+
+} // anonymous namespace
+
+const char *getCacheDir(const Target &target) {
+  static std::string dir;
+  const char *value = getenv("OSXCROSS_SDK_PCH_DIR");
+
+  if (value && *value)
+    return value;
+
+  if (!target.sdkpch || !(value = getenv("HOME")) || !*value)
+    return nullptr;
+
+  dir = value;
+  dir += "/.cache/osxcross/sdk-pch";
+  return dir.c_str();
+}
+
+bool apply(Target &target, bool lookupOnly) {
+  trace::Span span("sdkpch: apply");
+  const char *cachedir = getCacheDir(target);
+  std::string source;
+  std::string prefix;
+  const char *language;
+
+  if (!cachedir || target.mode != DriverMode::compile || !target.isClang() ||
+      target.targetarchs.size() > 1 || target.language ||
+      !getSourceFile(target, source) ||
+      !(language = getLanguage(source.c_str())))
+    return false;
+
+  for (auto &arg : target.args) {
+    if (isIncompatible(arg))
+      return false;
+  }
+
+  if (!getUmbrellaPrefix(source, prefix))
+    return false;
+
+  // The build command: the invocation minus its source and outputs.
+  string_vector command;
+  string_vector cmd;
+  hash_type hash = FNV1aBasis;
+  std::string stamp;
+  bool relative = false;
+
+  target.getCommand(command);
+
+  for (size_t i = 0; i < command.size(); ++i) {
+    const std::string &arg = command[i];
+    const bool hasValue = i && arg[0] == '-' &&
+                          driver::takesSeparateValue(arg.c_str()) &&
+                          i + 1 < command.size();
+    size_t len;
+
+    if (i && arg == source)
+      continue;
+
+    if (arg == "-c" || arg == "-o" || (i && isDependencyOption(arg))) {
+      if (hasValue)
+        ++i;
+      continue;
+    }
+
+    if (i && isSearchPathOption(arg, len)) {
+      const char *path = arg.size() > len ? arg.c_str() + len
+                         : hasValue       ? command[i + 1].c_str()
+                                          : "/";
+      relative |= *path != '/';
+    }
+
+    if (arg == "-isysroot" && hasValue) {
+      getFileStamp(command[i + 1], stamp);
+      addKey(hash, stamp);
+    }
+
+    cmd.push_back(arg);
+
+    if (hasValue)
+      cmd.push_back(command[++i]);
+  }
+
+  addKey(hash, SDKPCHMagic);
+  getFileStamp(target.compilerpath, stamp);
+  addKey(hash, target.compilerpath);
+  addKey(hash, stamp);
+  addKey(hash, target.clangversion.Str());
+  addKey(hash, target.getTriple());
+  addKey(hash, getStdLibString(target.stdlib));
+  addKey(hash, target.OSNum.Str());
+  addKey(hash, language);
+  addKey(hash, prefix);
+
+  for (auto &arg : cmd)
+    addKey(hash, arg);
+
+  if (relative) {
+    char cwd[PATH_MAX + 1];
+
+    if (!getcwd(cwd, sizeof(cwd)))
+      return false;
+
+    addKey(hash, cwd);
+  }
+
+  std::string base = cachedir;
+  base += PATHDIV;
+  base += hashToString(hash);
+
+  const std::string pch = base + ".pch";
+  const std::string header = base + ".h";
+
+  if (!fileExists(pch)) {
+    if (lookupOnly || !createDirectory(cachedir))
+      return false;
+
+    cmd.push_back("-x");
+    cmd.push_back(std::string(language) + "-header");
+    cmd.push_back(header);
+    cmd.push_back("-o");
+
+    if (!build(target.compilerpath, cmd, header, prefix, pch))
+      return false;
+  }
+
+  target.fargs.push_back("-include-pch");
+  target.fargs.push_back(pch);
+  return true;
+}
+
+} // namespace sdkpch
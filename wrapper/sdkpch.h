@@ -0,0 +1,55 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace target {
+struct Target;
+}
+
+namespace sdkpch {
+
+using target::Target;
+
+//
+// SDK precompiled headers
+//
+// With -foc-sdk-pch or 'OSXCROSS_SDK_PCH_DIR' (env), compile (-c)
+// invocations whose source starts with SDK umbrella headers
+// (#import <Foundation/Foundation.h>, ...) get a precompiled header of
+// those through -include-pch. PCHs are kept in 'OSXCROSS_SDK_PCH_DIR'
+// (default: ~/.cache/osxcross/sdk-pch). Their key covers
+//
+//  - the compiler binary (file stamp) and its version,
+//  - the SDK path (file stamp), the triple, the C++ standard library and
+//    the deployment target,
+//  - the language, the umbrella headers and the remaining flags.
+//
+// A missing PCH is built under a lock by the first invocation that needs
+// it. Builds the compiler rejects leave a '<key>.pch.failed' file with its
+// output and are not retried while that file exists.
+//
+
+const char *getCacheDir(const Target &target);
+
+// Adds -include-pch to the command of 'target' if its source qualifies.
+// With 'lookupOnly', missing PCHs are not built.
+bool apply(Target &target, bool lookupOnly = false);
+
+} // namespace sdkpch
@@ -21,15 +21,14 @@
 
 #include "compat.h"
 
-#include <iostream>
 #include <string>
-#include <sstream>
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <cstring>
 #include <strings.h>
 #include <cstdlib>
+#include <cstdio>
 #include <climits>
 #include <cassert>
 #include <sys/stat.h>
@@ -37,26 +36,47 @@
 
 #include "tools.h"
 #include "target.h"
+#include "manifest.h"
+#include "sdkcatalog.h"
+#include "trace.h"
+
+extern int debug;
 
 namespace target {
 
-Target::Target()
+Target::Target(const char *execpath)
     : vendor(getDefaultVendor()), SDK(getenv("OSXCROSS_SDKROOT")),
-      supportedarchs(getSupportedArchs()),
-      arch(getDefaultArch()), target(getDefaultTarget()), stdlib(StdLib::unset),
+      SDKSearched(), SDKNotFound(), arch(getDefaultArch()),
+      target(getDefaultTarget()), stdlib(StdLib::unset),
       usegcclibs(), wliblto(-1), compiler(getDefaultCompilerIdentifier()),
-      compilername(getDefaultCompilerName()), language() {
-  if (!getExecutablePath(execpath, sizeof(execpath)))
+      compilername(getDefaultCompilerName()), language(),
+      mode(DriverMode::link), objectInputsOnly(), sdkpch() {
+  if (execpath)
+    snprintf(this->execpath, sizeof(this->execpath), "%s", execpath);
+  else if (!getExecutablePath(this->execpath, sizeof(this->execpath)))
     abort();
+}
+
+// The SDK search directory is only scanned once the SDK is actually needed,
+// so that invocations answered from the setup cache never touch it.
+const char *Target::getSDK() const {
+  if (!SDK && !SDKSearched) {
+    const char *SDKSearchDir = getSDKSearchDir();
 
-  const char *SDKSearchDir = getSDKSearchDir();
+    SDKSearched = true;
+
+    if (SDKSearchDir[0])
+      SDKNotFound = !overrideDefaultSDKPath(SDKSearchDir);
+  }
 
-  if (!SDK && SDKSearchDir[0])
-    overrideDefaultSDKPath(SDKSearchDir);
+  return SDK;
 }
 
 OSVersion Target::getSDKOSNum() const {
-  if (SDK) {
+  if (SDKVersion.Num())
+    return SDKVersion;
+
+  if (const char *SDK = getSDK()) {
     std::string SDKPath = SDK;
 
     while (SDKPath.size() && SDKPath[SDKPath.size() - 1] == PATHDIV)
@@ -72,112 +92,84 @@ OSVersion Target::getSDKOSNum() const {
     if (target.size() < 7)
       return OSVersion();
 
-    double n = atof(target.c_str() + 6);
-
-    if (n >= 27.0f) {
-      // Darwin 27 and later correspond directly to macOS 27 and later.
-
-      int major = (int)n;
-      int minor = (int)(((n - (int)n) * 10.0) + 0.1);
-
-      return OSVersion(major, minor);
-    } else if (n >= 25.0f) {
-      // Darwin 25 corresponds to macOS 26.
-      // Darwin 26 was skipped.
+    if (target == getDefaultTarget())
+      return getDefaultTargetOSVersion();
 
-      int major = (int)n + 1;
-      int minor = (int)(((n - (int)n) * 10.0) + 0.1);
-
-      return OSVersion(major, minor);
-    } else if (n >= 20.0f) {
-      // MacOS 11-15
-
-      int major = 11 + ((int)n % 20);
-      int minor = (int)(((n - (int)n) * 10.0) + 0.1);
-
-      // Adjust for early versions where the minor version was offset by -1
-
-      // Darwin 23.0 => macOS 14.0
-      // Darwin 23.1 => macOS 14.1
-
-      // Darwin 22.1 => macOS 13.0
-      // Darwin 22.2 => macOS 13.1
-
-      // ...
-
-      if (n < 23.0f) {
-        minor -= 1;
-      }
+    char *end;
+    int major = strtol(target.c_str() + 6, &end, 10);
+    int minor = *end == '.' ? strtol(end + 1, nullptr, 10) : 0;
 
-      return OSVersion(major, minor);
-    } else {
-      // MacOS 10
-      return OSVersion(10, (int)n - 4);
-    }
+    return getDarwinOSVersion(major, minor);
   }
 }
 
-void Target::overrideDefaultSDKPath(const char *SDKSearchDir) {
+bool Target::overrideDefaultSDKPath(const char *SDKSearchDir) const {
+  sdkcatalog::Catalog catalog;
   std::string defaultSDKPath;
 
   defaultSDKPath = SDKSearchDir;
   defaultSDKPath += PATHDIV;
   defaultSDKPath += "default";
 
-  struct stat st;
+  if (!sdkcatalog::getCatalog(SDKSearchDir, catalog)) {
+    err << "no SDK found in '" << SDKSearchDir << "'" << err.endl();
+    return false;
+  }
 
-  if (!lstat(defaultSDKPath.c_str(), &st)) {
-    if (!S_ISLNK(st.st_mode)) {
-      err << "'" << defaultSDKPath << "' must be a symlink to an SDK"
-          << err.endl();
-      exit(EXIT_FAILURE);
-    }
+  switch (catalog.defaultSDK) {
+  case sdkcatalog::notlink:
+    err << "'" << defaultSDKPath << "' must be a symlink to an SDK"
+        << err.endl();
+    return false;
+  case sdkcatalog::broken:
+    err << "'" << defaultSDKPath << "' broken symlink" << err.endl();
+    return false;
+  case sdkcatalog::symlink:
+    SDK = safeStrdup(catalog.defaultSDKPath.c_str()); // intentionally leaked
+    return true;
+  case sdkcatalog::none:
+    break;
+  }
 
-    if (char *resolved = realpath(defaultSDKPath.c_str(), nullptr)) {
-      SDK = resolved;
-    } else {
-      err << "'" << defaultSDKPath << "' broken symlink" << err.endl();
-      exit(EXIT_FAILURE);
-    }
-  } else {
-    // Choose the latest SDK
+  // Choose the latest SDK
 
-    static OSVersion latestSDKVersion;
-    static std::string latestSDK;
+  const sdkcatalog::SDK *latestSDK = catalog.getLatestSDK();
 
-    latestSDKVersion = OSVersion();
-    latestSDK.clear();
+  if (!latestSDK) {
+    err << "no SDK found in '" << SDKSearchDir << "'" << err.endl();
+    return false;
+  }
 
-    listFiles(SDKSearchDir, nullptr, [](const char *SDK) {
-      if (!strncasecmp(SDK, "MacOSX", 6)) {
-        OSVersion SDKVersion = parseOSVersion(SDK + 6);
-        if (SDKVersion > latestSDKVersion) {
-          latestSDKVersion = SDKVersion;
-          latestSDK = SDK;
-        }
-      }
-      return false;
-    });
+  std::string SDKPath;
 
-    if (!latestSDKVersion.Num()) {
-      err << "no SDK found in '" << SDKSearchDir << "'" << err.endl();
-      exit(EXIT_FAILURE);
-    }
+  SDKPath = SDKSearchDir;
+  SDKPath += PATHDIV;
+  SDKPath += latestSDK->name;
 
-    std::string SDKPath;
+  SDK = safeStrdup(SDKPath.c_str()); // intentionally leaked
+  SDKDefaultDeploymentTarget = latestSDK->defaultDeploymentTarget;
+  return true;
+}
 
-    SDKPath = SDKSearchDir;
-    SDKPath += PATHDIV;
-    SDKPath += latestSDK;
+OSVersion Target::getSDKDefaultDeploymentTarget() const {
+  std::string SDKPath;
 
-    SDK = safeStrdup(SDKPath.c_str()); // intentionally leaked
-  }
+  if (getSDK() && SDKDefaultDeploymentTarget.Num())
+    return SDKDefaultDeploymentTarget;
+
+  if (!getSDKPath(SDKPath))
+    return OSVersion();
+
+  return sdkcatalog::readDefaultDeploymentTarget(SDKPath);
 }
 
 bool Target::getSDKPath(std::string &path, bool MacOSX10_16Fix, bool majorVersionOnly) const {
   OSVersion SDKVer = getSDKOSNum();
 
-  if (SDK) {
+  if (SDKNotFound)
+    return false; // OSXCROSS_SDK_SEARCH_DIR; already reported
+
+  if (const char *SDK = getSDK()) {
     path = SDK;
   } else {
     if (MacOSX10_16Fix)
@@ -258,7 +250,12 @@ bool Target::getMacPortsFrameworksDir(std::string &path) const {
 }
 
 bool Target::archSupported(const Arch arch) {
-  return std::find(supportedarchs.begin(), supportedarchs.end(), arch) != supportedarchs.end();
+  for (const Arch *a = getSupportedArchs(); *a != Arch::unknown; ++a) {
+    if (*a == arch)
+      return true;
+  }
+
+  return false;
 }
 
 bool Target::checkArchs() {
@@ -335,6 +332,24 @@ bool Target::isKnownCompiler() const {
   return compiler != Compiler::UNKNOWN;
 }
 
+void Target::getCommand(string_vector &cmd, bool redirectedStderr) const {
+  cmd = fargs;
+  cmd.insert(cmd.end(), args.begin(), args.end());
+
+  if (!redirectedStderr || !isClang() || !isatty(STDERR_FILENO))
+    return;
+
+  for (auto &arg : args) {
+    if (!strncmp(arg.c_str(), "-fcolor-diagnostics", 19) ||
+        !strncmp(arg.c_str(), "-fno-color-diagnostics", 22) ||
+        !strncmp(arg.c_str(), "-fdiagnostics-color", 19) ||
+        !strncmp(arg.c_str(), "-fno-diagnostics-color", 22))
+      return;
+  }
+
+  cmd.push_back("-fcolor-diagnostics");
+}
+
 
 const std::string &Target::buildDefaultTriple(std::string &triple,
   bool GCC, bool useAarch64InsteadOfArm64) const {
@@ -369,7 +384,9 @@ void Target::setCompilerPath() {
       compilerpath += compilername;
       compilerexecname = compilername;
     } else {
-      if (!findExecutableInPath(compilername.c_str(), compilerpath, ignoreCCACHE))
+      if (!manifest::lookupTool(compilername.c_str(), compilerpath) &&
+          !findExecutableInPath(compilername.c_str(), compilerpath,
+                                ignoreCCACHE))
         compilerpath = compilername;
 
       compilerexecname += compilername;
@@ -378,13 +395,23 @@ void Target::setCompilerPath() {
 }
 
 bool Target::findClangIntrinsicHeaders(std::string &path) {
-  static std::stringstream dir;
+  static std::string dir;
 
   assert(isClang());
 
   if (compilerpath.empty())
     return false;
 
+  std::string version;
+  std::string stamppath;
+
+  if (manifest::lookup(manifest::ClangIntrinsics, compilerpath.c_str(), path,
+                       &version, &stamppath)) {
+    this->clangversion = parseClangVersion(version.c_str());
+    dependencies.push_back(stamppath);
+    return true;
+  }
+
   std::string clangbindir = compilerpath;
   stripFileName(clangbindir);
 
@@ -393,27 +420,26 @@ bool Target::findClangIntrinsicHeaders(std::string &path) {
 
   clangversion = &this->clangversion;
 
-  clear(dir);
+  dir.clear();
   *clangversion = ClangVersion();
   pathtmp.clear();
 
   auto tryDir = [&]()->bool {
-    listFiles(dir.str().c_str(), nullptr, [](const char *file) {
-      if (file[0] != '.' && isDirectory(file, dir.str().c_str())) {
+    listFiles(dir.c_str(), nullptr, [](const char *file) {
+      if (file[0] != '.' && isDirectory(file, dir.c_str())) {
         ClangVersion cv = parseClangVersion(file);
 
         if (cv != ClangVersion()) {
-          static std::stringstream tmp;
-          clear(tmp);
+          static std::string tmp;
 
-          auto checkDir = [&](std::stringstream &dir) {
+          auto checkDir = [&](std::string &dir) {
             static std::string intrindir;
             auto &file = dir;
 
-            intrindir = dir.str();
-            file << "/xmmintrin.h";
+            intrindir = dir;
+            file += "/xmmintrin.h";
 
-            if (fileExists(file.str())) {
+            if (fileExists(file)) {
               if (cv > *clangversion) {
                 *clangversion = cv;
                 pathtmp.swap(intrindir);
@@ -424,11 +450,10 @@ bool Target::findClangIntrinsicHeaders(std::string &path) {
             return false;
           };
 
-          tmp << dir.str() << "/" << file << "/include";
+          tmp = dir + "/" + file + "/include";
 
           if (!checkDir(tmp)) {
-            clear(tmp);
-            tmp << dir.str() << "/" << file;
+            tmp = dir + "/" + file;
             checkDir(tmp);
           }
         }
@@ -441,12 +466,14 @@ bool Target::findClangIntrinsicHeaders(std::string &path) {
 
 #define TRYDIR(basedir, subdir)                                                \
 do {                                                                           \
-  dir << basedir << subdir;                                                    \
+  dir = basedir;                                                               \
+  dir += subdir;                                                               \
   if (tryDir()) {                                                              \
+    dependencies.push_back(dir);                                               \
     path.swap(pathtmp);                                                        \
     return true;                                                               \
   }                                                                            \
-  clear(dir);                                                                  \
+  dir.clear();                                                                 \
 } while (0)
 
 #define TRYDIR2(libdir) TRYDIR(clangbindir, libdir)
@@ -497,14 +524,41 @@ do {                                                                           \
 #undef TRYDIR3
 }
 
+// Finds the latest GCC version in <...>/include/c++.
+bool Target::findGCCVersion(const std::string &CXXHeaderPath,
+                            GCCVersion &version) {
+  std::string value;
+
+  if (manifest::lookup(manifest::GCCVersion, CXXHeaderPath.c_str(), value)) {
+    version = parseGCCVersion(value.c_str());
+    return true;
+  }
+
+  static std::vector<GCCVersion> v;
+  v.clear();
+
+  listFiles(CXXHeaderPath.c_str(), nullptr, [](const char *path) {
+    if (path[0] != '.')
+      v.push_back(parseGCCVersion(path));
+    return false;
+  });
+
+  if (v.empty())
+    return false;
+
+  std::sort(v.begin(), v.end());
+  version = v[v.size() - 1];
+  return true;
+}
+
 void Target::setupGCCLibs(Arch arch) {
   assert(stdlib == StdLib::libstdcxx);
   fargs.push_back("-nodefaultlibs");
 
   std::string SDKPath;
-  std::stringstream GCCTriple;
-  std::stringstream GCCLibSTDCXXPath;
-  std::stringstream GCCLibPath;
+  std::string GCCTriple;
+  std::string GCCLibSTDCXXPath;
+  std::string GCCLibPath;
 
   const bool dynamic = !!getenv("OSXCROSS_GCC_NO_STATIC_RUNTIME");
   // The i386 runtime is a multilib of the x86_64 GCC installation.
@@ -512,20 +566,26 @@ void Target::setupGCCLibs(Arch arch) {
 
   getSDKPath(SDKPath);
 
-  GCCTriple << GCCArch << "-" << vendor << "-" << target;
+  GCCTriple = GCCArch;
+  GCCTriple += "-";
+  GCCTriple += vendor;
+  GCCTriple += "-";
+  GCCTriple += target;
 
-  GCCLibPath << SDKPath << "/../../lib/gcc/" << GCCTriple.str() << "/"
-             << gccversion.Str();
+  GCCLibPath = SDKPath + "/../../lib/gcc/" + GCCTriple + "/" +
+               gccversion.Str();
 
-  GCCLibSTDCXXPath << SDKPath << "/../../" << GCCTriple.str() << "/lib";
+  GCCLibSTDCXXPath = SDKPath + "/../../" + GCCTriple + "/lib";
 
   switch (arch) {
   case Arch::i386:
   case Arch::i486:
   case Arch::i586:
   case Arch::i686:
-    GCCLibPath << "/" << getArchName(Arch::i386);
-    GCCLibSTDCXXPath << "/" << getArchName(Arch::i386);
+    GCCLibPath += "/";
+    GCCLibPath += getArchName(Arch::i386);
+    GCCLibSTDCXXPath += "/";
+    GCCLibSTDCXXPath += getArchName(Arch::i386);
     break;
   default:
     ;
@@ -533,20 +593,17 @@ void Target::setupGCCLibs(Arch arch) {
 
   if (dynamic) {
     fargs.push_back("-L");
-    fargs.push_back(GCCLibPath.str());
+    fargs.push_back(GCCLibPath);
     fargs.push_back("-L");
-    fargs.push_back(GCCLibSTDCXXPath.str());
+    fargs.push_back(GCCLibSTDCXXPath);
   }
 
-  auto addLib = [&](const std::stringstream &path, const char *lib) {
+  auto addLib = [&](const std::string &path, const char *lib) {
     if (dynamic) {
       fargs.push_back("-l");
       fargs.push_back(lib);
     } else {
-      static std::stringstream tmp;
-      clear(tmp);
-      tmp << path.str() << "/lib" << lib << ".a";
-      fargs.push_back(tmp.str());
+      fargs.push_back(path + "/lib" + lib + ".a");
     }
   };
 
@@ -575,7 +632,96 @@ void Target::setTriple(bool useAarch64InsteadOfArm64) {
   triple += target;
 }
 
+void Target::setEnv(const char *name, const std::string &value) {
+  setenv(name, value.c_str(), 1);
+  environment.push_back(name);
+  environment.push_back(value);
+}
+
+//
+// Handoff
+//
+// Wrapper invocations started by the compiler (ld, as, lipo, ...) receive
+// the parent's resolved target through 'OSXCROSS_RESOLVED_TARGET' (env)
+// instead of looking for the SDK again.
+//
+
+namespace {
+
+constexpr const char *HandoffEnvVar = "OSXCROSS_RESOLVED_TARGET";
+constexpr const char *HandoffMagic = "osxcross-handoff-1";
+
+// Environment variables the SDK selection depends on.
+constexpr const char *HandoffEnvVars[] = {
+  "OSXCROSS_SDKROOT",
+  "OSXCROSS_SDK_SEARCH_DIR"
+};
+
+// "=<value>" if set, "" otherwise
+std::string getEnvValue(const char *name) {
+  const char *val = getenv(name);
+  return val ? std::string("=") + val : std::string();
+}
+
+} // anonymous namespace
+
+bool Target::loadHandoff() {
+  const char *p = getenv(HandoffEnvVar);
+
+  if (!p)
+    return false;
+
+  const char *end = p + strlen(p);
+  std::string magic, path, value, SDKPath, version, OSVer, resolvedTriple,
+      flavor;
+
+  if (!getRecord(p, end, magic) || magic != HandoffMagic ||
+      !getRecord(p, end, path) || path != execpath)
+    return false;
+
+  for (const char *name : HandoffEnvVars)
+    if (!getRecord(p, end, value) || value != getEnvValue(name))
+      return false;
+
+  if (!getRecord(p, end, SDKPath) || !getRecord(p, end, version) ||
+      !getRecord(p, end, OSVer) || !getRecord(p, end, resolvedTriple) ||
+      !getRecord(p, end, flavor) || flavor != getBuildFlavor() || p != end)
+    return false;
+
+  SDK = safeStrdup(SDKPath.c_str()); // intentionally leaked
+  SDKSearched = true;
+  SDKVersion = parseOSVersion(version.c_str());
+  OSNum = parseOSVersion(OSVer.c_str());
+  triple = resolvedTriple;
+
+  if (debug)
+    dbg << "using resolved target of parent invocation (" << triple << ")"
+        << dbg.endl();
+
+  return true;
+}
+
+void Target::storeHandoff(const std::string &SDKPath) {
+  std::string record;
+
+  putRecord(record, HandoffMagic);
+  putRecord(record, execpath);
+
+  for (const char *name : HandoffEnvVars)
+    putRecord(record, getEnvValue(name));
+
+  putRecord(record, SDKPath);
+  putRecord(record, getSDKOSNum().Str());
+  putRecord(record, OSNum.Str());
+  putRecord(record, triple);
+  putRecord(record, getBuildFlavor());
+
+  setEnv(HandoffEnvVar, record);
+}
+
 bool Target::setup() {
+  trace::Span span("setup: arch checks");
+
   if (targetarchs.empty())
     addArch(arch);
 
@@ -583,65 +729,69 @@ bool Target::setup() {
     return false;
   }
 
-  std::string SDKPath;
-  OSVersion SDKOSNum = getSDKOSNum();
+  span.end();
 
   if (!isKnownCompiler())
     warn << "unknown compiler '" << compilername << "'" << warn.endl();
 
+  if (mode == DriverMode::info) {
+    // --version, -v, ...: the SDK does not matter. No -arch flags are
+    // passed on, so the first architecture given decides clang's triple
+    // (-dumpmachine).
+    if (isClang())
+      arch = targetarchs[0];
+
+    setTriple();
+    setCompilerPath();
+    dependencies.push_back(compilerpath);
+    fargs.push_back(compilerexecname);
+
+    if (isClang()) {
+      fargs.push_back("-target");
+      fargs.push_back(getTriple());
+    }
+
+    return true;
+  }
+
+  trace::Span SDKSpan("setup: SDK lookup");
+  std::string SDKPath;
+  OSVersion SDKOSNum = getSDKOSNum();
+
   if (!getSDKPath(SDKPath))
     return false;
 
+  SDKSpan.end();
+
+  trace::Span compilerSpan("setup: compiler path");
   setTriple();
   setCompilerPath();
+  compilerSpan.end();
 
-  constexpr struct {
-    Arch arch;
-    OSVersion SDKVer;
-    bool lower;
-  } RequiredSDKVersion[] = {
-    { Arch::i386,    {10, 13}, true },
-    { Arch::x86_64h, {10, 8} },
-    { Arch::arm64,   {11, 0} },
-    { Arch::arm64e,  {11, 0} },
-  };
-
-  for (auto &RequiredSDK : RequiredSDKVersion) {
-    if (haveArch(RequiredSDK.arch)) {
+  dependencies.push_back(SDKPath);
+  dependencies.push_back(compilerpath);
 
-      if (RequiredSDK.lower) {
-        if (SDKOSNum > RequiredSDK.SDKVer) {
-          err << "Architecture '" << getArchName(RequiredSDK.arch) << "' requires "
-              << "macOS " << RequiredSDK.SDKVer.shortStr() << " SDK (or earlier)"
-              << err.endl();
-          return false;
-        }
-      } else {
-        if (SDKOSNum < RequiredSDK.SDKVer) {
-          err << "Architecture '" << getArchName(RequiredSDK.arch) << "' requires "
-              << "macOS " << RequiredSDK.SDKVer.shortStr() << " SDK (or later)"
-              << err.endl();
-          return false;
-        }
-      }
+  for (auto &req : ArchRequirements) {
+    if (!haveArch(req.arch))
+      continue;
 
+    if (req.SDKVerIsMaximum ? SDKOSNum > req.SDKVer : SDKOSNum < req.SDKVer) {
+      err << "Architecture '" << getArchName(req.arch) << "' requires "
+          << "macOS " << req.SDKVer.shortStr() << " SDK (or "
+          << (req.SDKVerIsMaximum ? "earlier" : "later") << ")" << err.endl();
+      return false;
     }
   }
 
   if (!OSNum.Num()) {
-    OSVersion defaultMinTarget = getDefaultMinTarget();
+    constexpr OSVersion defaultMinTarget = getDefaultMinTarget();
 
     if (defaultMinTarget != OSVersion()) {
-      // Default version is given via -DOSXCROSS_OSX_VERSION_MIN=XX
+      // Default version is given via OSX_VERSION_MIN (config.h)
 
-      if (haveArch(Arch::arm64) || haveArch(Arch::arm64e)) {
-        // Default to >= 11.0 for arm64
-        OSNum = std::max(defaultMinTarget, OSVersion(11, 0));
-      }
-
-      if (haveArch(Arch::x86_64h)) {
-        // Default to >= 10.8 for x86_64h
-        OSNum = std::max(OSNum, std::max(defaultMinTarget, OSVersion(10, 8)));
+      for (auto &req : ArchRequirements) {
+        if (haveArch(req.arch))
+          OSNum = std::max(OSNum, std::max(defaultMinTarget, req.minTarget));
       }
 
       if (stdlib == StdLib::libcxx) {
@@ -651,7 +801,7 @@ bool Target::setup() {
     }
 
     if (!OSNum.Num()) {
-      // Default min version = -DOSXCROSS_OSX_VERSION_MIN=XX or SDK version
+      // Default min version = OSX_VERSION_MIN or SDK version
       OSNum = defaultMinTarget != OSVersion() ? defaultMinTarget : SDKOSNum;
     }
   }
@@ -692,6 +842,10 @@ bool Target::setup() {
     return false;
   }
 
+  // Links of object files do not search headers.
+  const bool needHeaders = !objectInputsOnly;
+
+  trace::Span CXXSpan("setup: C++ headers");
   std::string CXXHeaderPath = SDKPath;
   string_vector AdditionalCXXHeaderPaths;
 
@@ -706,7 +860,7 @@ bool Target::setup() {
   switch (stdlib) {
   case StdLib::libcxx: {
     CXXHeaderPath += "/usr/include/c++/v1";
-    if (!dirExists(CXXHeaderPath)) {
+    if (needHeaders && !dirExists(CXXHeaderPath)) {
       err << "cannot find " << getStdLibString(stdlib) << " headers"
           << err.endl();
       return false;
@@ -728,9 +882,10 @@ bool Target::setup() {
 
       std::string CXXBuildTriple;
 
-      if (targetarchs.size() > 1) { // TODO: should probably check earlier for this
-        err << "clang++-gstdc++ does not support multiple architectures in "
-              "one invocation"
+      // Compiling and linking go through fanout::split() instead.
+      if (targetarchs.size() > 1) {
+        err << "clang++-gstdc++ supports multiple architectures for "
+               "compiling and linking only (-g: in separate steps)"
             << err.endl();
         return false;
       }
@@ -756,25 +911,14 @@ bool Target::setup() {
 
       CXXHeaderPath += CXXBuildTriple;
       CXXHeaderPath += "/include/c++";
+      dependencies.push_back(CXXHeaderPath);
 
-      static std::vector<GCCVersion> v;
-      v.clear();
-
-      listFiles(CXXHeaderPath.c_str(), nullptr, [](const char *path) {
-        if (path[0] != '.')
-          v.push_back(parseGCCVersion(path));
-        return false;
-      });
-
-      if (v.empty()) {
+      if (!findGCCVersion(CXXHeaderPath, gccversion)) {
         err << "'-foc-use-gcc-libstdc++' requires gcc to be installed "
                "(./build_gcc.sh)" << err.endl();
         return false;
       }
 
-      std::sort(v.begin(), v.end());
-      gccversion = v[v.size() - 1];
-
       CXXHeaderPath += "/";
       CXXHeaderPath += gccversion.Str();
 
@@ -796,7 +940,7 @@ bool Target::setup() {
 
     addCXXPath("backward");
 
-    if (!dirExists(CXXHeaderPath)) {
+    if (needHeaders && !dirExists(CXXHeaderPath)) {
       err << "cannot find " << getStdLibString(stdlib) << " headers"
           << err.endl();
       return false;
@@ -808,6 +952,7 @@ bool Target::setup() {
     abort();
   }
 
+  CXXSpan.end();
   fargs.push_back(compilerexecname);
 
   std::string ClangIntrinsicPath;
@@ -829,7 +974,11 @@ bool Target::setup() {
     }
 
 #ifndef __APPLE__
-    if (!findClangIntrinsicHeaders(ClangIntrinsicPath)) {
+    trace::Span intrinsicSpan("setup: intrinsic headers");
+    bool foundIntrinsicHeaders = findClangIntrinsicHeaders(ClangIntrinsicPath);
+    intrinsicSpan.end();
+
+    if (!foundIntrinsicHeaders) {
       warn << "cannot find clang intrinsic headers; please report this "
               "issue to the OSXCross project" << warn.endl();
     } else {
@@ -858,7 +1007,7 @@ bool Target::setup() {
       }
 
       if (stdlib == StdLib::libstdcxx && usegcclibs && targetarchs.size() < 2 &&
-          !isGCH()) {
+          !isGCH() && mode == DriverMode::link) {
         // Use libs from './build_gcc' installation
         setupGCCLibs(targetarchs[0]);
       }
@@ -891,10 +1040,12 @@ bool Target::setup() {
     fargs.push_back(path);
   };
 
-  addCXXHeaderPath(CXXHeaderPath);
+  if (needHeaders) {
+    addCXXHeaderPath(CXXHeaderPath);
 
-  for (auto &path : AdditionalCXXHeaderPaths)
-    addCXXHeaderPath(path);
+    for (auto &path : AdditionalCXXHeaderPaths)
+      addCXXHeaderPath(path);
+  }
 
   if (getenv("OSXCROSS_MP_INC")) {
     std::string MacPortsIncludeDir;
@@ -904,7 +1055,10 @@ bool Target::setup() {
     // Add them to args (instead of fargs),
     // so the user's -I / -L / -F is prefered.
 
-    if (getMacPortsIncludeDir(MacPortsIncludeDir)) {
+    bool haveMacPortsIncludeDir = getMacPortsIncludeDir(MacPortsIncludeDir);
+    dependencies.push_back(MacPortsIncludeDir);
+
+    if (haveMacPortsIncludeDir) {
       args.push_back("-isystem");
       args.push_back(MacPortsIncludeDir);
 
@@ -923,7 +1077,7 @@ bool Target::setup() {
     }
   }
 
-  if (isClang() && !ClangIntrinsicPath.empty()) {
+  if (isClang() && needHeaders && !ClangIntrinsicPath.empty()) {
     fargs.push_back("-isystem");
     fargs.push_back(ClangIntrinsicPath);
   }
@@ -994,12 +1148,8 @@ bool Target::setup() {
 #endif
 
   if (isClang()) {
-    if (buildFlavor.IsLLVM() &&
-        std::find(args.begin(), args.end(), "-c") == args.end() &&
-        std::find(args.begin(), args.end(), "-E") == args.end() &&
-        std::find(args.begin(), args.end(), "-S") == args.end()) {
+    if (buildFlavor.IsLLVM() && mode == DriverMode::link)
       fargs.push_back("-fuse-ld=lld");
-    }
 
     if (getenv("OSXCROSS_PRETEND_TO_BE_APPLE_CLANG")) {
       fargs.push_back("-D__apple_build_version__=1");
@@ -1024,18 +1174,6 @@ bool Target::setup() {
 
     if (getenv("OSXCROSS_ENABLE_WERROR_IMPLICIT_FUNCTION_DECLARATION"))
       fargs.push_back("-Werror=implicit-function-declaration");
-  } else if (isGCC()) {
-    if (args.empty() || (args.size() == 1 && args[0] == "-v")) {
-      //
-      // HACK:
-      // Discard all arguments besides the first one
-      // (which is <arch>-apple-darwinXX-gcc) to fix the issue
-      // described in #135.
-      //
-
-      while (fargs.size() > 1)
-        fargs.erase(fargs.end() - 1);
-    }
   }
 
   bool isgcclibstdcxx =
@@ -1065,12 +1203,13 @@ bool Target::setup() {
 
   if (buildFlavor.IsLLVM() && isGCC()) {
     // The LLVM as wrapper needs GCC's selected deployment target.
-    setenv("OSXCROSS_AS_TARGET_VERSION", OSNum.shortStr().c_str(), 1);
+    setEnv("OSXCROSS_AS_TARGET_VERSION", OSNum.shortStr());
   } else if (isgcclibstdcxx) {
     // Silence 'operator new[]' warning in ld64.
-    setenv("OSXCROSS_GCC_LIBSTDCXX", "1", 1);
+    setEnv("OSXCROSS_GCC_LIBSTDCXX", "1");
   }
 
+  storeHandoff(SDKPath);
   return true;
 }
 } // namespace target
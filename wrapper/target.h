@@ -19,6 +19,8 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
  ***********************************************************************/
 
+#include "config.h" // generated by the Makefile
+
 namespace target {
 
 using namespace tools;
@@ -51,23 +53,13 @@ constexpr const char *getSupportedArchsString(bool GCC = false) {
              : OSXCROSS_SUPPORTED_ARCHS;
 }
 
-static inline std::vector<Arch> getSupportedArchs(bool GCC = false) {
-  std::vector<Arch> result;
-  std::istringstream iss(GCC ? OSXCROSS_GCC_TARGET_ARCHS
-                             : OSXCROSS_SUPPORTED_ARCHS);
-  std::string token;
-
-  while (iss >> token)
-    result.push_back(parseArch(token.c_str()));
-
-  return result;
+// Terminated by Arch::unknown
+constexpr const Arch *getSupportedArchs(bool GCC = false) {
+  return GCC ? config::GCCTargetArchs : config::SupportedArchs;
 }
-static inline Arch getDefaultArch(bool GCC = false) {
-  std::istringstream iss(GCC ? OSXCROSS_GCC_TARGET_ARCHS
-                             : OSXCROSS_SUPPORTED_ARCHS);
-  std::string first;
-  iss >> first;
-  return parseArch(first.c_str());
+
+constexpr Arch getDefaultArch(bool GCC = false) {
+  return getSupportedArchs(GCC)[0];
 }
 
 constexpr const char *getLinkerVersion() { return OSXCROSS_LINKER_VERSION; }
@@ -90,16 +82,46 @@ constexpr const char *getOSXCrossVersion() {
 #endif
 }
 
-#ifdef OSXCROSS_OSX_VERSION_MIN
-inline OSVersion getDefaultMinTarget() {
-  if (!strcmp(OSXCROSS_OSX_VERSION_MIN, "default"))
-    return OSVersion();
+constexpr OSVersion getDefaultMinTarget() { return config::DefaultMinTarget; }
+
+//
+// Darwin version => macOS version
+//
+// Darwin 9-19 => 10.5-10.15, Darwin 20-24 => 11-15 (the minor version is
+// offset by -1 before Darwin 23), Darwin 25 => 26 (Darwin 26 was skipped),
+// Darwin 27 and later => 27 and later.
+//
+
+constexpr OSVersion getDarwinOSVersion(int major, int minor) {
+  return major >= 27 ? OSVersion(major, minor)
+       : major >= 25 ? OSVersion(major + 1, minor)
+       : major >= 23 ? OSVersion(major - 9, minor)
+       : major >= 20 ? OSVersion(major - 9, minor - 1)
+       : OSVersion(10, major - 4);
+}
 
-  return parseOSVersion(OSXCROSS_OSX_VERSION_MIN);
+constexpr OSVersion getDefaultTargetOSVersion() {
+  return getDarwinOSVersion(config::TargetDarwinMajor,
+                            config::TargetDarwinMinor);
 }
-#else
-constexpr OSVersion getDefaultMinTarget() { return OSVersion(); }
-#endif
+
+//
+// Per-arch constraints
+//
+
+struct ArchRequirement {
+  Arch arch;
+  OSVersion SDKVer;      // minimum SDK version
+  bool SDKVerIsMaximum;  // ... or maximum
+  OSVersion minTarget;   // minimum default deployment target
+};
+
+constexpr ArchRequirement ArchRequirements[] = {
+  { Arch::i386,    {10, 13}, true,  {}       },
+  { Arch::x86_64h, {10, 8},  false, {10, 8}  },
+  { Arch::arm64,   {11, 0},  false, {11, 0}  },
+  { Arch::arm64e,  {11, 0},  false, {11, 0}  },
+};
 
 inline const char *getSDKSearchDir() {
   const char *SDKSearchDir = getenv("OSXCROSS_SDK_SEARCH_DIR");
@@ -154,15 +176,35 @@ private:
   int type_;
 };
 
+//
+// Driver mode
+//
+// The last phase the compiler runs, as requested by the arguments (see
+// commandopts::parse()). Ordered: -E wins over -fsyntax-only over -S over -c.
+//
+
+enum class DriverMode {
+  info,       // only --version, -v, ... and no inputs; nothing is compiled
+  preprocess, // -E
+  syntaxOnly, // -fsyntax-only
+  assemble,   // -S
+  compile,    // -c
+  link
+};
+
 //
 // Target
 //
 
 struct Target {
-  Target();
+  // 'execpath': directory of the wrapper; defaults to the directory of
+  // this executable.
+  explicit Target(const char *execpath = nullptr);
 
+  const char *getSDK() const;
   OSVersion getSDKOSNum() const;
-  void overrideDefaultSDKPath(const char *SDKSearchDir);
+  OSVersion getSDKDefaultDeploymentTarget() const;
+  bool overrideDefaultSDKPath(const char *SDKSearchDir) const;
   bool getSDKPath(std::string &path, bool MacOSX10_16Fix = false, bool majorVersionOnly = false) const;
 
   bool getMacPortsDir(std::string &path) const;
@@ -194,14 +236,25 @@ struct Target {
 
   void setCompilerPath();
   bool findClangIntrinsicHeaders(std::string &path);
+  bool findGCCVersion(const std::string &CXXHeaderPath, GCCVersion &version);
 
   void setupGCCLibs(Arch arch);
   void setTriple(bool useAarch64InsteadOfArm64 = false);
+  void setEnv(const char *name, const std::string &value);
+  bool loadHandoff();
+  void storeHandoff(const std::string &SDKPath);
   bool setup();
 
+  // fargs + args. With 'redirectedStderr', diagnostics are replayed on the
+  // terminal later and are asked to be colored.
+  void getCommand(string_vector &cmd, bool redirectedStderr = false) const;
+
   const char *vendor;
-  const char *SDK;
-  std::vector<Arch> supportedarchs;
+  mutable const char *SDK;      // resolved lazily, see getSDK()
+  mutable bool SDKSearched;
+  mutable bool SDKNotFound;     // no usable SDK in OSXCROSS_SDK_SEARCH_DIR
+  mutable OSVersion SDKDefaultDeploymentTarget;
+  OSVersion SDKVersion;         // set by loadHandoff()
   Arch arch;
   std::vector<Arch> targetarchs;
   std::string target;
@@ -219,8 +272,13 @@ struct Target {
   string_vector fargs;
   string_vector args;
   const char *language;
+  DriverMode mode;
+  bool objectInputsOnly;        // links object files / libraries only
+  bool sdkpch;                  // -foc-sdk-pch, see sdkpch.h
   char execpath[PATH_MAX + 1];
   std::string intrinsicpath;
+  string_vector dependencies;   // paths setup() derived its result from
+  string_vector environment;    // name, value pairs exported by setup()
   BuildFlavor buildFlavor;
 };
 
@@ -23,18 +23,18 @@
 
 #include <vector>
 #include <string>
-#include <sstream>
-#include <istream>
-#include <fstream>
-#include <iostream>
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
 #include <climits>
 #include <cassert>
+#include <cerrno>
+#include <ctime>
 #include <sys/time.h>
 #include <sys/stat.h>
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -59,9 +59,84 @@
 #endif
 
 #include "tools.h"
+#include "trace.h"
 
 namespace tools {
 
+//
+// Output
+//
+
+static bool writeFully(int fd, const char *data, size_t len) {
+  while (len) {
+    ssize_t n = write(fd, data, len);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return false;
+
+    data += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+Output out(STDOUT_FILENO);
+Output errout(STDERR_FILENO);
+
+Output &Output::write(const char *str, size_t n) {
+  if (sink) {
+    sink->append(str, n);
+    return *this;
+  }
+
+  if (len + n > sizeof(buf)) {
+    flush();
+
+    if (n > sizeof(buf)) {
+      failed |= !writeFully(fd, str, n);
+      return *this;
+    }
+  }
+
+  memcpy(buf + len, str, n);
+  len += n;
+  return *this;
+}
+
+bool Output::flush() {
+  if (len) {
+    failed |= !writeFully(fd, buf, len);
+    len = 0;
+  }
+
+  return !failed;
+}
+
+Output &Output::operator<<(const Color &color) {
+  if (isTerminal()) {
+    char esc[16];
+    write(esc, snprintf(esc, sizeof(esc), "\033[%dm", color.code()));
+  }
+
+  return *this;
+}
+
+Output &Output::operator<<(double val) {
+  char tmp[32];
+  return write(tmp, snprintf(tmp, sizeof(tmp), "%g", val));
+}
+
+//
+// Error message helper
+//
+
+unsigned long Message::printed = 0;
+std::string *Message::capture = nullptr;
+
 //
 // Terminal text colors
 //
@@ -82,11 +157,10 @@ bool isTerminal() {
 // Executable path
 //
 
-char *getExecutablePath(char *buf, size_t len) {
+char *getExecutableFile(char *buf, size_t len) {
   if (!buf || !len)
     return nullptr;
 
-  char *p;
 #ifdef __APPLE__
   unsigned int l = len;
   if (_NSGetExecutablePath(buf, &l) != 0)
@@ -139,14 +213,22 @@ char *getExecutablePath(char *buf, size_t len) {
     l = 0;
   delete[] argv;
 #else
+  trace::Probe probe("readlink", "/proc/self/exe");
   ssize_t l = readlink("/proc/self/exe", buf, len - 1);
+  probe(l > 0);
   assert(l > 0 && "/proc not mounted?");
   if (l > 0) buf[l] = '\0';
 #endif
   if (l <= 0)
     return nullptr;
   buf[len - 1] = '\0';
-  p = strrchr(buf, PATHDIV);
+  return buf;
+}
+
+char *getExecutablePath(char *buf, size_t len) {
+  if (!getExecutableFile(buf, len))
+    return nullptr;
+  char *p = strrchr(buf, PATHDIV);
   if (p)
     *p = '\0';
   return buf;
@@ -175,18 +257,17 @@ const std::string &getParentProcessName() {
     return name;
   }
 #else
-  std::stringstream file;
-  file << "/proc/" << ppid << "/comm";
-  if (getFileContent(file.str(), name)) {
+  char file[64];
+  snprintf(file, sizeof(file), "/proc/%ld/comm", static_cast<long>(ppid));
+  if (getFileContent(file, name)) {
     if (!name.empty() && name.rbegin()[0] == '\n') {
       name.resize(name.size() - 1);
     }
     return name;
   } else {
-    clear(file);
-    file << "/proc/" << ppid << "/exe";
+    snprintf(file, sizeof(file), "/proc/%ld/exe", static_cast<long>(ppid));
     char buf[PATH_MAX + 1];
-    ssize_t len = readlink(file.str().c_str(), buf, sizeof(buf) - 1);
+    ssize_t len = readlink(file, buf, sizeof(buf) - 1);
     if (len > 0) {
       buf[len] = '\0';
       name = getName(buf);
@@ -205,6 +286,18 @@ const std::string &getParentProcessName() {
 void concatEnvVariable(const char *var, const std::string &val) {
   std::string nval = val;
   if (char *oldval = getenv(var)) {
+    // Nested invocations would otherwise prepend the same value over and
+    // over again.
+    for (const char *p = oldval; *p;) {
+      const char *e = strchr(p, ':');
+      size_t len = e ? e - p : strlen(p);
+
+      if (val.size() == len && !val.compare(0, len, p, len))
+        return;
+
+      p += e ? len + 1 : len;
+    }
+
     nval += ":";
     nval += oldval;
   }
@@ -230,6 +323,66 @@ std::string &escapePath(const std::string &path, std::string &escapedpath) {
   return escapedpath;
 }
 
+bool splitCommandLine(const std::string &line, string_vector &args) {
+  std::string arg;
+  bool inarg = false;
+
+  args.clear();
+
+  for (size_t i = 0; i < line.size(); ++i) {
+    char c = line[i];
+
+    switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      if (inarg)
+        args.push_back(arg);
+      arg.clear();
+      inarg = false;
+      continue;
+    case '\'': {
+      size_t end = line.find('\'', i + 1);
+
+      if (end == std::string::npos)
+        return false;
+
+      arg.append(line, i + 1, end - i - 1);
+      i = end;
+      break;
+    }
+    case '"':
+      for (++i; i < line.size() && line[i] != '"'; ++i) {
+        if (line[i] == '\\' && i + 1 < line.size() &&
+            strchr("\"\\$`", line[i + 1]))
+          ++i;
+
+        arg += line[i];
+      }
+
+      if (i == line.size())
+        return false;
+      break;
+    case '\\':
+      if (++i == line.size())
+        return false;
+
+      arg += line[i];
+      break;
+    default:
+      arg += c;
+    }
+
+    inarg = true;
+  }
+
+  if (inarg)
+    args.push_back(arg);
+
+  return true;
+}
+
 void splitPath(const char *path, std::vector<std::string> &result) {
   char *sp;
   char *xpath = safeStrdup(path);
@@ -261,47 +414,181 @@ bool hasPath(const std::vector<std::string> &path, const char *find) {
   return false;
 }
 
+//
+// Processes
+//
+
+pid_t spawnProcess(const std::string &file, const string_vector &cmd,
+                   int outfd, int errfd) {
+  std::vector<char *> argv;
+  argv.reserve(cmd.size() + 1);
+
+  for (auto &arg : cmd)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+
+  argv.push_back(nullptr);
+
+  // The child would write out whatever is still buffered once more.
+  out.flush();
+  errout.flush();
+
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    if (outfd != -1)
+      dup2(outfd, STDOUT_FILENO);
+
+    if (errfd != -1)
+      dup2(errfd, STDERR_FILENO);
+
+    execvp(file.c_str(), argv.data());
+    err << "cannot execute '" << file << "'" << err.endl();
+    errout.flush();
+    _exit(127);
+  }
+
+  if (pid == -1)
+    err << "cannot execute '" << file << "': fork() failed" << err.endl();
+
+  return pid;
+}
+
+int waitProcess(pid_t pid) {
+  int status;
+
+  if (pid == -1)
+    return 1;
+
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR)
+      return 1;
+  }
+
+  if (WIFSIGNALED(status))
+    return 128 + WTERMSIG(status);
+
+  return WEXITSTATUS(status);
+}
+
 //
 // Files and Directories
 //
 
 std::string *getFileContent(const std::string &file, std::string &content) {
-  std::ifstream f(file.c_str());
+  trace::Probe probe("open", file.c_str());
+  int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
 
-  if (!f.is_open())
+  if (!probe(fd != -1))
     return nullptr;
 
-  f.seekg(0, std::ios::end);
-  auto len = f.tellg();
-  f.seekg(0, std::ios::beg);
+  getFDContent(fd, content);
+  close(fd);
+  return &content;
+}
 
-  if (len != static_cast<decltype(len)>(-1))
-    content.reserve(static_cast<size_t>(len));
+bool getFDContent(int fd, std::string &content) {
+  struct stat st;
+  content.clear();
 
-  content.assign(std::istreambuf_iterator<char>(f),
-                 std::istreambuf_iterator<char>());
+  if (!fstat(fd, &st) && st.st_size > 0)
+    content.reserve(static_cast<size_t>(st.st_size));
 
-  return &content;
+  char buf[4096];
+  ssize_t n;
+
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    content.append(buf, n);
+  }
+
+  return true;
 }
 
 bool writeFileContent(const std::string &file, const std::string &content) {
-  std::ofstream f(file.c_str());
+  int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+  if (fd == -1)
+    return false;
+
+  bool ok = writeFully(fd, content.data(), content.size());
+  return !close(fd) && ok;
+}
+
+// Writes to a temporary file first and renames it into place, so concurrent
+// readers either see the old or the new content, but never a partial file.
+bool writeFileContentAtomic(const std::string &file,
+                            const std::string &content) {
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".tmp.%ld.%llu",
+           static_cast<long>(getpid()), getNanoSeconds());
+
+  std::string tmpfile = file + suffix;
 
-  if (!f.is_open())
+  if (!writeFileContent(tmpfile, content) ||
+      rename(tmpfile.c_str(), file.c_str())) {
+    unlink(tmpfile.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool createDirectory(const std::string &dir) {
+  if (dir.empty() || dirExists(dir))
+    return true;
+
+  std::string parent = dir;
+  stripFileName(parent);
+
+  if (parent != dir && !createDirectory(parent))
     return false;
 
-  f << content;
-  return f.good();
+  // Another process may have won the race.
+  return !mkdir(dir.c_str(), 0777) || (errno == EEXIST && dirExists(dir));
 }
 
 bool fileExists(const std::string &file) {
   struct stat st;
-  return !stat(file.c_str(), &st);
+  trace::Probe probe("stat", file.c_str());
+  return probe(!stat(file.c_str(), &st));
 }
 
 bool dirExists(const std::string &dir) {
   struct stat st;
-  return !stat(dir.c_str(), &st) && S_ISDIR(st.st_mode);
+  trace::Probe probe("stat", dir.c_str());
+  return probe(!stat(dir.c_str(), &st)) && S_ISDIR(st.st_mode);
+}
+
+// Identifies the state of a file or directory. Directories change their
+// modification time when entries are added, removed or renamed.
+void getFileStamp(const std::string &path, std::string &stamp) {
+  struct stat st;
+  char buf[96];
+  trace::Probe probe("stat", path.c_str());
+
+  if (!probe(!stat(path.c_str(), &st))) {
+    stamp = "missing";
+    return;
+  }
+
+#ifdef __APPLE__
+  const struct timespec &mtime = st.st_mtimespec;
+#else
+  const struct timespec &mtime = st.st_mtim;
+#endif
+
+  snprintf(buf, sizeof(buf), "%lld.%ld:%llu:%lld",
+           static_cast<long long>(mtime.tv_sec),
+           static_cast<long>(mtime.tv_nsec),
+           static_cast<unsigned long long>(st.st_ino),
+           static_cast<long long>(st.st_size));
+
+  stamp = buf;
 }
 
 typedef bool (*listfilescallback)(const char *file);
@@ -312,18 +599,21 @@ bool isDirectory(const char *file, const char *prefix) {
     std::string tmp = prefix;
     tmp += "/";
     tmp += file;
-    return !stat(tmp.c_str(), &st) && S_ISDIR(st.st_mode);
+    trace::Probe probe("stat", tmp.c_str());
+    return probe(!stat(tmp.c_str(), &st)) && S_ISDIR(st.st_mode);
   } else {
-    return !stat(file, &st) && S_ISDIR(st.st_mode);
+    trace::Probe probe("stat", file);
+    return probe(!stat(file, &st)) && S_ISDIR(st.st_mode);
   }
 }
 
 bool listFiles(const char *dir, std::vector<std::string> *files,
                listfilescallback cmp) {
+  trace::Probe probe("opendir", dir);
   DIR *d = opendir(dir);
   dirent *de;
 
-  if (!d)
+  if (!probe(d != nullptr))
     return false;
 
   while ((de = readdir(d))) {
@@ -337,7 +627,8 @@ bool listFiles(const char *dir, std::vector<std::string> *files,
 }
 
 bool isExecutable(const char *f, const struct stat &) {
-  return !access(f, F_OK | X_OK);
+  trace::Probe probe("access", f);
+  return probe(!access(f, F_OK | X_OK));
 }
 
 bool ignoreCCACHE(const char *f, const struct stat &) {
@@ -372,11 +663,14 @@ bool findExecutableInPath(const char *file, std::string &result,
     result += PATHDIV;
     result += file;
 
-    if (!stat(result.c_str(), &st)) {
+    trace::Probe probe("stat", result.c_str());
+
+    if (probe(!stat(result.c_str(), &st))) {
       if (lookupSymlinks) {
+        trace::Probe probe("realpath", result.c_str());
         char *resolved = realpath(result.c_str(), nullptr);
 
-        if (!resolved) {
+        if (!probe(resolved != nullptr)) {
           result.clear();
         } else {
           result.assign(resolved);
@@ -415,6 +709,13 @@ void stripFileName(std::string &path) {
     path.resize(lastpathdiv);
 }
 
+void stripFileExtension(std::string &path) {
+  size_t ext = path.find_last_of('.');
+
+  if (ext != std::string::npos && ext > path.find_last_of(PATHDIV) + 1)
+    path.resize(ext);
+}
+
 const char *getFileName(const char *file) {
   const char *p = strrchr(file, PATHDIV);
 
@@ -461,6 +762,202 @@ time_type getNanoSeconds() {
   abort();
 }
 
+//
+// Hashing
+//
+
+hash_type hashData(const void *data, size_t len, hash_type hash) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+std::string hashToString(hash_type hash) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", hash);
+  return buf;
+}
+
+namespace {
+
+bool hashFileTree(const std::string &path, const struct stat &st,
+                  hash_type &hash, bool stampsOnly) {
+  if (S_ISLNK(st.st_mode)) {
+    char target[PATH_MAX + 1];
+    ssize_t len = readlink(path.c_str(), target, sizeof(target) - 1);
+
+    if (len < 0)
+      return false;
+
+    hash = hashData("L", 1, hash);
+    hash = hashData(target, len, hash);
+    return true;
+  }
+
+  if (S_ISDIR(st.st_mode)) {
+    std::vector<std::string> files;
+
+    if (!listFiles(path.c_str(), &files, [](const char *name) {
+          return strcmp(name, ".") && strcmp(name, "..");
+        }))
+      return false;
+
+    std::sort(files.begin(), files.end());
+    hash = hashData("D", 1, hash);
+
+    for (auto &file : files) {
+      std::string filepath = path + PATHDIV + file;
+      struct stat filest;
+
+      if (lstat(filepath.c_str(), &filest))
+        return false;
+
+      hash = hashData(file.c_str(), file.size() + 1, hash);
+
+      if (!hashFileTree(filepath, filest, hash, stampsOnly))
+        return false;
+    }
+
+    return true;
+  }
+
+  if (stampsOnly) {
+#ifdef __APPLE__
+    const struct timespec &mtime = st.st_mtimespec;
+#else
+    const struct timespec &mtime = st.st_mtim;
+#endif
+    const long long stamp[] = { mtime.tv_sec, mtime.tv_nsec,
+                                static_cast<long long>(st.st_ino),
+                                static_cast<long long>(st.st_size) };
+
+    hash = hashData("S", 1, hash);
+    hash = hashData(stamp, sizeof(stamp), hash);
+    return true;
+  }
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  char buf[65536];
+  ssize_t len;
+
+  if (fd == -1)
+    return false;
+
+  hash = hashData("F", 1, hash);
+
+  while ((len = read(fd, buf, sizeof(buf))) > 0)
+    hash = hashData(buf, len, hash);
+
+  close(fd);
+  return len == 0;
+}
+
+} // anonymous namespace
+
+bool hashFileTree(const std::string &path, hash_type &hash) {
+  struct stat st;
+
+  hash = FNV1aBasis;
+  return !stat(path.c_str(), &st) && hashFileTree(path, st, hash, false);
+}
+
+bool hashFileTreeStamps(const std::string &path, hash_type &hash) {
+  struct stat st;
+
+  hash = FNV1aBasis;
+  return !stat(path.c_str(), &st) && hashFileTree(path, st, hash, true);
+}
+
+//
+// Records
+//
+
+void putRecord(std::string &out, const std::string &str) {
+  char len[32];
+  snprintf(len, sizeof(len), "%zu:", str.size());
+  out += len;
+  out += str;
+  out += '\n';
+}
+
+void putRecord(std::string &out, size_t n) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%zu", n);
+  putRecord(out, std::string(buf));
+}
+
+void putRecord(std::string &out, const string_vector &v) {
+  putRecord(out, v.size());
+
+  for (auto &str : v)
+    putRecord(out, str);
+}
+
+bool getRecord(const char *&p, const char *end, std::string &str) {
+  char *lenend;
+  unsigned long len = strtoul(p, &lenend, 10);
+
+  if (lenend == p || lenend >= end || *lenend != ':')
+    return false;
+
+  p = lenend + 1;
+
+  if (static_cast<size_t>(end - p) < len + 1 || p[len] != '\n')
+    return false;
+
+  str.assign(p, len);
+  p += len + 1;
+  return true;
+}
+
+bool getRecord(const char *&p, const char *end, size_t &n) {
+  std::string str;
+
+  if (!getRecord(p, end, str))
+    return false;
+
+  n = strtoul(str.c_str(), nullptr, 10);
+  return true;
+}
+
+bool getRecord(const char *&p, const char *end, string_vector &v) {
+  size_t n;
+
+  // Every record takes at least 3 bytes ("0:\n").
+  if (!getRecord(p, end, n) || n > static_cast<size_t>(end - p) / 3)
+    return false;
+
+  v.resize(n);
+
+  for (auto &str : v)
+    if (!getRecord(p, end, str))
+      return false;
+
+  return true;
+}
+
+void escapeJSON(std::string &out, const char *str) {
+  for (const char *p = str; *p; ++p) {
+    unsigned char c = *p;
+
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+}
+
 //
 // OSVersion
 //
@@ -19,6 +19,8 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
  ***********************************************************************/
 
+#include <sys/types.h>
+
 struct stat;
 
 namespace tools {
@@ -29,11 +31,6 @@ namespace tools {
 
 typedef std::vector<std::string> string_vector;
 
-static inline void clear(std::stringstream &sstr) {
-  sstr.clear();
-  sstr.str(std::string());
-}
-
 static inline bool endsWith(std::string const &str, std::string const &end) {
   if (end.size() > str.size())
     return false;
@@ -92,14 +89,66 @@ class Color {
   ColorCode cc;
 public:
   Color(ColorCode cc) : cc(cc) {}
-  friend std::ostream &
-  operator<<(std::ostream &os, const Color &color) {
-    if (isTerminal())
-      return os << "\033[" << color.cc << "m";
-    return os;
+  ColorCode code() const { return cc; }
+};
+
+//
+// Output
+//
+// Buffered output to a file descriptor, or appended to a string, without
+// iostreams. Writes out on '\n', when full and on destruction.
+//
+
+class Output {
+public:
+  explicit Output(int fd) : fd(fd), sink(), len(), failed() {}
+  explicit Output(std::string *sink)
+      : fd(-1), sink(sink), len(), failed() {}
+  ~Output() { flush(); }
+
+  static constexpr char endl() { return '\n'; }
+
+  Output &write(const char *str, size_t n);
+  bool flush(); // false if writing failed at any point
+
+  Output &operator<<(const char *str) { return write(str, strlen(str)); }
+  Output &operator<<(const std::string &str) {
+    return write(str.data(), str.size());
+  }
+  Output &operator<<(char c) {
+    write(&c, 1);
+    if (c == '\n')
+      flush();
+    return *this;
+  }
+  Output &operator<<(const Color &color);
+  Output &operator<<(double val);
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value ||
+                              std::is_enum<T>::value,
+                          Output &>::type
+  operator<<(T val) {
+    char buf[24];
+    int n = std::is_signed<T>::value || std::is_enum<T>::value
+                ? snprintf(buf, sizeof(buf), "%lld", (long long)val)
+                : snprintf(buf, sizeof(buf), "%llu", (unsigned long long)val);
+    return write(buf, n);
   }
+
+private:
+  Output(const Output &) = delete;
+  Output &operator=(const Output &) = delete;
+
+  int fd;
+  std::string *sink;
+  size_t len;
+  bool failed;
+  char buf[4096];
 };
 
+extern Output out;    // stdout
+extern Output errout; // stderr
+
 //
 // Error message helper
 //
@@ -108,29 +157,43 @@ static class Message {
 private:
   const char *msg;
   Color color;
-  std::ostream &os;
+  Output &os;
   bool printprefix;
 public:
   static constexpr char endl() { return '\n'; }
   bool isendl(char c) { return c == '\n'; }
   template<typename T>
   bool isendl(T&&) { return false; }
+  // Number of messages printed so far (by all Message instances).
+  static unsigned long printed;
+  // If set, messages are appended there (uncolored) instead (libosxcross).
+  static std::string *capture;
   template<typename T>
   Message &operator<<(T &&v) {
+    if (capture) {
+      Output captured(capture);
+      if (printprefix) {
+        captured << "osxcross: " << msg << ": ";
+        printprefix = false;
+        ++printed;
+      }
+      if (isendl(v))
+        printprefix = true;
+      captured << v;
+      return *this;
+    }
     if (printprefix) {
       os << Color(FG_DARK_GRAY) << "osxcross: " << color << msg << ": "
          << Color(FG_DEFAULT);
       printprefix = false;
+      ++printed;
     }
-    if (isendl(v)) {
+    if (isendl(v))
       printprefix = true;
-      os << std::endl;
-    } else {
-      os << v;
-    }
+    os << v;
     return *this;
   }
-  Message(const char *msg, Color color = FG_RED, std::ostream &os = std::cerr)
+  Message(const char *msg, Color color = FG_RED, Output &os = errout)
       : msg(msg), color(color), os(os), printprefix(true) {}
 } warn("warning"), err("error"), dbg("debug", FG_LIGHT_MAGENTA),
   info("info", FG_LIGHT_MAGENTA), warninfo("info", FG_LIGHT_MAGENTA);
@@ -139,6 +202,7 @@ public:
 // Executable path
 //
 
+char *getExecutableFile(char *buf, size_t len);
 char *getExecutablePath(char *buf, size_t len);
 const std::string &getParentProcessName();
 std::string &fixPathDiv(std::string &path);
@@ -149,10 +213,26 @@ std::string &fixPathDiv(std::string &path);
 
 void concatEnvVariable(const char *var, const std::string &val);
 std::string &escapePath(const std::string &path, std::string &escapedpath);
+// Splits a command line into arguments like a POSIX shell would, apart from
+// expansions: '...', "..." (with \", \\, \$ and \` escapes) and \<char>.
+// Fails on unterminated quotes.
+bool splitCommandLine(const std::string &line, string_vector &args);
 void splitPath(const char *path, std::vector<std::string> &result);
 std::string joinPath(const std::vector<std::string> &path);
 bool hasPath(const std::vector<std::string> &path, const char *find);
 
+//
+// Processes
+//
+
+// Starts 'cmd' (looked up like execvp() does) with stdout and stderr
+// redirected to 'outfd' and 'errfd' (-1: inherited). Returns -1 on failure.
+pid_t spawnProcess(const std::string &file, const string_vector &cmd,
+                   int outfd = -1, int errfd = -1);
+
+// Exit code of a spawned process; 128 + the signal if it was killed.
+int waitProcess(pid_t pid);
+
 //
 // Files and directories
 //
@@ -160,10 +240,15 @@ bool hasPath(const std::vector<std::string> &path, const char *find);
 constexpr char PATHDIV = '/';
 
 std::string *getFileContent(const std::string &file, std::string &content);
+bool getFDContent(int fd, std::string &content);
 bool writeFileContent(const std::string &file, const std::string &content);
+bool writeFileContentAtomic(const std::string &file,
+                            const std::string &content);
+bool createDirectory(const std::string &dir);
 
 bool fileExists(const std::string &dir);
 bool dirExists(const std::string &dir);
+void getFileStamp(const std::string &path, std::string &stamp);
 typedef bool (*listfilescallback)(const char *file);
 bool isDirectory(const char *file, const char *prefix);
 bool listFiles(const char *dir, std::vector<std::string> *files,
@@ -179,6 +264,7 @@ bool findCommandDirectory(const char *command, std::string &result,
                           findexecfilter cmp = nullptr);
 
 void stripFileName(std::string &path);
+void stripFileExtension(std::string &path); // dir/file.o -> dir/file
 
 const char *getFileName(const char *file);
 const char *getFileExtension(const char *file);
@@ -195,6 +281,57 @@ inline const char *getFileExtension(const std::string &file) {
 // Argument Parsing
 //
 
+// Groups table entries by one character of their spelling, so that a lookup
+// only compares the entries sharing that character with the argument.
+// Entries keep their table order within a group. Built on first use.
+template <size_t size> struct OptionIndex {
+  static constexpr size_t numGroups = 129; // ASCII, everything else
+
+  static size_t group(const char *str, size_t pos) {
+    for (size_t i = 0; i < pos; ++i)
+      if (!str[i])
+        return 0;
+
+    unsigned char c = str[pos];
+    return c < 128 ? c : 128;
+  }
+
+  template <typename Entry>
+  void build(const Entry (&entries)[size], size_t pos) {
+    unsigned short next[numGroups] = {};
+
+    for (const Entry &entry : entries)
+      ++first[group(entry.name, pos) + 1];
+
+    for (size_t g = 0; g < numGroups; ++g) {
+      first[g + 1] += first[g];
+      next[g] = first[g];
+    }
+
+    for (size_t i = 0; i < size; ++i)
+      order[next[group(entries[i].name, pos)]++] = i;
+
+    built = true;
+  }
+
+  template <typename Entry, typename Match>
+  const Entry *find(const Entry (&entries)[size], const char *str, size_t pos,
+                    Match match) const {
+    size_t g = group(str, pos);
+
+    for (size_t i = first[g]; i < first[g + 1]; ++i) {
+      if (match(entries[order[i]]))
+        return &entries[order[i]];
+    }
+
+    return nullptr;
+  }
+
+  unsigned short first[numGroups + 1];
+  unsigned short order[size];
+  bool built;
+};
+
 // Parser for compiler options such as -I, -arch, and -stdlib.
 template <typename T, size_t size = 0> struct OptParser {
   // Defines both how an option receives its value and which spellings match.
@@ -251,15 +388,16 @@ template <typename T, size_t size = 0> struct OptParser {
   // Returns the first option whose spelling accepts arg. Table order therefore
   // determines precedence if option spellings overlap.
   const Option *parse(const char *arg) const {
-    for (const Option &option : options) {
-      if (option.matches(arg))
-        return &option;
-    }
+    if (!index.built)
+      index.build(options, 1); // "-<c>..."
 
-    return nullptr;
+    return index.find(options, arg, 1, [arg](const Option &option) {
+      return option.matches(arg);
+    });
   }
 
   const bool debug;
+  mutable OptionIndex<size> index;
 
   // Prints the resolved option, its optional value, and its forwarding policy
   // when debugging was enabled while constructing the parser.
@@ -295,23 +433,64 @@ template <typename T, size_t size = 0> struct ArgParser {
     while (*arg && *arg == '-')
       ++arg;
 
-    for (size_t i = 0; i < size; ++i) {
-      const Bind &bind = binds[i];
+    if (!index.built)
+      index.build(binds, 0);
 
-      if (!strcmp(arg, bind.name)) {
-        if (argc - numArg <= bind.numArgs) {
-          err << "too few arguments for '-" << bind.name << "'" << err.endl();
-          return nullptr;
-        }
+    const Bind *bind = index.find(binds, arg, 0, [arg](const Bind &bind) {
+      return !strcmp(arg, bind.name);
+    });
 
-        return &bind;
-      }
+    if (bind && argc - numArg <= bind->numArgs) {
+      err << "too few arguments for '-" << bind->name << "'" << err.endl();
+      return nullptr;
     }
 
-    return nullptr;
+    return bind;
   }
+
+  OptionIndex<size> index;
 };
 
+//
+// Hashing
+//
+
+typedef unsigned long long hash_type;
+
+// 64-bit FNV-1a. Not cryptographic; callers must verify hits themselves.
+constexpr hash_type FNV1aBasis = 14695981039346656037ULL;
+hash_type hashData(const void *data, size_t len, hash_type hash = FNV1aBasis);
+
+inline hash_type hashString(const std::string &str,
+                            hash_type hash = FNV1aBasis) {
+  return hashData(str.data(), str.size(), hash);
+}
+
+std::string hashToString(hash_type hash);
+
+// Hashes the content of a file, or of everything below a directory: names,
+// file contents and symlink targets, in sorted order.
+bool hashFileTree(const std::string &path, hash_type &hash);
+
+// Like hashFileTree(), but with the file stamps (mtime, inode, size) in place
+// of file contents; a stat walk, nothing is read.
+bool hashFileTreeStamps(const std::string &path, hash_type &hash);
+
+//
+// Records
+//
+
+// Length-prefixed strings: <len>:<data>\n
+void putRecord(std::string &out, const std::string &str);
+void putRecord(std::string &out, size_t n);
+void putRecord(std::string &out, const string_vector &v);
+bool getRecord(const char *&p, const char *end, std::string &str);
+bool getRecord(const char *&p, const char *end, size_t &n);
+bool getRecord(const char *&p, const char *end, string_vector &v);
+
+// Appends 'str' escaped for use within a JSON string.
+void escapeJSON(std::string &out, const char *str);
+
 //
 // Time
 //
@@ -405,27 +584,27 @@ struct OSVersion {
   }
 
   std::string Str() const {
-    std::stringstream tmp;
-    tmp << major << "." << minor << "." << patch;
-    return tmp.str();
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%d.%d.%d", major, minor, patch);
+    return buf;
   }
 
   std::string shortStr() const {
-    std::stringstream tmp;
-    tmp << major << "." << minor;
-    return tmp.str();
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%d.%d", major, minor);
+    return buf;
   }
 
   std::string majorStr() const {
-    std::stringstream tmp;
-    tmp << major;
-    return tmp.str();
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", major);
+    return buf;
   }
 
   std::string numStr() const {
-    std::stringstream tmp;
-    tmp << Num();
-    return tmp.str();
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", Num());
+    return buf;
   }
 
   int major;
@@ -0,0 +1,262 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "tools.h"
+#include "trace.h"
+
+namespace trace {
+
+using namespace tools;
+
+bool enabled = false;
+bool probing = false;
+
+namespace {
+
+struct Event {
+  const char *name;
+  char phase; // 'X': complete event, 'i': instant event
+  time_type start;
+  time_type duration;
+  std::string detail;
+};
+
+const char *tracedir;
+std::string command;
+std::string process;
+time_type processstart;
+std::vector<Event> events;
+bool written;
+
+struct ProbeRecord {
+  const char *op;
+  std::string path;
+  bool found;
+  time_type duration;
+};
+
+const char *probelog;
+std::vector<ProbeRecord> probes;
+
+void addTime(std::string &out, const char *name, time_type ns) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), ",\"%s\":%llu.%03llu", name, ns / 1000,
+           ns % 1000);
+  out += buf;
+}
+
+// One event per line; tools/trace_merge.sh relies on that.
+void addEvent(std::string &out, const Event &event, const char *argname) {
+  char buf[64];
+
+  out += "{\"name\":\"";
+  escapeJSON(out, event.name);
+  out += "\",\"cat\":\"osxcross\",\"ph\":\"";
+  out += event.phase;
+  out += '"';
+  addTime(out, "ts", event.start);
+
+  if (event.phase == 'X')
+    addTime(out, "dur", event.duration);
+  else
+    out += ",\"s\":\"p\"";
+
+  snprintf(buf, sizeof(buf), ",\"pid\":%ld,\"tid\":%ld",
+           static_cast<long>(getpid()), static_cast<long>(getpid()));
+  out += buf;
+
+  if (argname && !event.detail.empty()) {
+    out += ",\"args\":{\"";
+    out += argname;
+    out += "\":\"";
+    escapeJSON(out, event.detail.c_str());
+    out += "\"}";
+  }
+
+  out += "}";
+}
+
+void writeProbeLog() {
+  std::map<std::string, size_t> counts;
+  time_type total = 0;
+  std::string out;
+  char buf[64];
+
+  for (auto &probe : probes) {
+    ++counts[probe.op];
+    total += probe.duration;
+  }
+
+  snprintf(buf, sizeof(buf), "{\"pid\":%ld,\"command\":\"",
+           static_cast<long>(getpid()));
+  out += buf;
+  escapeJSON(out, command.c_str());
+  snprintf(buf, sizeof(buf), "\",\"probes\":%zu", probes.size());
+  out += buf;
+  addTime(out, "us", total);
+  out += ",\"ops\":{";
+
+  for (auto &count : counts) {
+    snprintf(buf, sizeof(buf), "%s\"%s\":%zu",
+             &count == &*counts.begin() ? "" : ",", count.first.c_str(),
+             count.second);
+    out += buf;
+  }
+
+  out += "},\"calls\":[";
+
+  for (auto &probe : probes) {
+    out += &probe == &probes[0] ? "{\"op\":\"" : ",{\"op\":\"";
+    out += probe.op;
+    out += "\",\"path\":\"";
+    escapeJSON(out, probe.path.c_str());
+    out += probe.found ? "\",\"found\":true" : "\",\"found\":false";
+    addTime(out, "us", probe.duration);
+    out += "}";
+  }
+
+  out += "]}\n";
+
+  // A single write() to an O_APPEND file; lines of concurrent invocations
+  // do not interleave.
+  int fd = open(probelog, O_WRONLY | O_APPEND | O_CREAT, 0666);
+
+  if (fd == -1 || ::write(fd, out.c_str(), out.size()) !=
+                      static_cast<ssize_t>(out.size()))
+    warn << "cannot write probe log '" << probelog << "'" << warn.endl();
+
+  if (fd != -1)
+    close(fd);
+}
+
+} // anonymous namespace
+
+void init(int argc, char **argv) {
+  tracedir = getenv("OSXCROSS_TRACE");
+  probelog = getenv("OSXCROSS_PROBE_LOG");
+
+  enabled = tracedir && *tracedir;
+  probing = probelog && *probelog;
+
+  if (!enabled && !probing)
+    return;
+
+  processstart = Span::now();
+  process = getFileName(argv[0]);
+
+  for (int i = 0; i < argc; ++i) {
+    if (i)
+      command += ' ';
+    command += argv[i];
+  }
+
+  events.reserve(16);
+  atexit(write);
+}
+
+time_type Span::now() { return getNanoSeconds(); }
+
+void Span::end() {
+  if (!start)
+    return;
+
+  events.push_back({name, 'X', start, now() - start, std::string()});
+  start = 0;
+}
+
+bool Probe::operator()(bool found) {
+  if (!start)
+    return found;
+
+  time_type duration = Span::now() - start;
+
+  if (probing)
+    probes.push_back({op, path, found, duration});
+
+  if (enabled)
+    events.push_back({op, 'X', start, duration, path});
+
+  start = 0;
+  return found;
+}
+
+void exec(const char *file) {
+  if (enabled)
+    events.push_back({"exec", 'i', Span::now(), 0, file});
+
+  write();
+}
+
+void write() {
+  if (written)
+    return;
+
+  written = true;
+
+  if (probing)
+    writeProbeLog();
+
+  if (!enabled)
+    return;
+
+  std::string out;
+  char buf[128];
+
+  out += "{\"traceEvents\":[\n";
+
+  // Name the process after the command it runs.
+  snprintf(buf, sizeof(buf), "{\"name\":\"process_name\",\"ph\":\"M\","
+           "\"pid\":%ld,\"args\":{\"name\":\"", static_cast<long>(getpid()));
+  out += buf;
+  escapeJSON(out, process.c_str());
+  out += "\"}},\n";
+
+  addEvent(out, {"wrapper", 'X', processstart, Span::now() - processstart,
+                 command}, "command");
+
+  for (auto &event : events) {
+    out += ",\n";
+    addEvent(out, event, "file");
+  }
+
+  out += "\n]}\n";
+
+  std::string file = tracedir;
+  snprintf(buf, sizeof(buf), "%c%ld-%llu.json", PATHDIV,
+           static_cast<long>(getpid()), processstart);
+  file += buf;
+
+  if (!createDirectory(tracedir) || !writeFileContent(file, out))
+    warn << "cannot write trace file '" << file << "'" << warn.endl();
+}
+
+} // namespace trace
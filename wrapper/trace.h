@@ -0,0 +1,87 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace trace {
+
+using tools::time_type;
+
+//
+// Tracing
+//
+// With 'OSXCROSS_TRACE=<dir>' (env), every invocation writes the time spent
+// in its phases to '<dir>/<pid>-<time>.json' (Chrome trace format) right
+// before it executes the next program or exits.
+// tools/trace_merge.sh combines these files into one timeline.
+//
+
+extern bool enabled;
+
+void init(int argc, char **argv);
+
+// Records [start, now] as a complete event named 'name'. Spans of disabled
+// tracing cost a branch.
+class Span {
+public:
+  Span(const char *name) : name(name), start(enabled ? now() : 0) {}
+  ~Span() { end(); }
+
+  void end();
+
+  static time_type now();
+
+private:
+  const char *name;
+  time_type start;
+};
+
+//
+// Probe accounting
+//
+// With 'OSXCROSS_PROBE_LOG=<file>' (env), every invocation appends one JSON
+// line to <file> with the file system probes it issued (stat, realpath,
+// opendir, readlink, ...): their number per operation, and path, result
+// and duration of each. Probes also show up in the trace.
+//
+
+extern bool probing;
+
+class Probe {
+public:
+  Probe(const char *op, const char *path)
+      : op(op), path(path), start(enabled || probing ? Span::now() : 0) {}
+
+  // Records the probe with its outcome and returns 'found'. Call right
+  // after the system call.
+  bool operator()(bool found);
+
+private:
+  const char *op;
+  const char *path;
+  time_type start;
+};
+
+// Records the program about to be executed and writes the trace and the
+// probe log.
+void exec(const char *file);
+
+void write();
+
+} // namespace trace
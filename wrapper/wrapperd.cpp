@@ -0,0 +1,615 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+#include "compat.h"
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SO_NOSIGPIPE is used instead
+#endif
+
+#include "tools.h"
+#include "target.h"
+#include "progs.h"
+#include "driver.h"
+#include "compilecache.h"
+#include "libosxcross.h"
+#include "wrapperd.h"
+#include "trace.h"
+
+extern int debug;
+extern int unittest;
+extern char **environ;
+
+namespace wrapperd {
+
+using namespace tools;
+using namespace target;
+
+namespace {
+
+constexpr const char *ProtocolMagic = "osxcross-wrapperd-2";
+constexpr int ClientTimeout = 10; // seconds
+
+volatile sig_atomic_t stop;
+
+// Sockets are written with send() so that a peer going away does not raise
+// SIGPIPE.
+bool writeAll(int fd, const std::string &data) {
+  const char *p = data.c_str();
+  size_t left = data.size();
+
+  while (left) {
+    ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return false;
+
+    p += n;
+    left -= n;
+  }
+
+  return true;
+}
+
+bool readAll(int fd, std::string &data) {
+  char buf[16384];
+
+  while (true) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    if (n < 0)
+      return false;
+
+    if (n == 0)
+      return true;
+
+    data.append(buf, n);
+  }
+}
+
+bool getSocketAddress(const char *path, sockaddr_un &addr) {
+  if (strlen(path) >= sizeof(addr.sun_path))
+    return false;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  return true;
+}
+
+int connectTo(const char *path) {
+  sockaddr_un addr;
+
+  if (!getSocketAddress(path, addr))
+    return -1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd == -1)
+    return -1;
+
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+void setReceiveTimeout(int fd) {
+  timeval timeout = { ClientTimeout, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+void toStringVector(char *const *strs, string_vector &v) {
+  for (; *strs; ++strs)
+    v.push_back(*strs);
+}
+
+// The returned array points into 'v'.
+char **toArgv(const string_vector &v, std::vector<char *> &argv) {
+  argv.clear();
+
+  for (auto &str : v)
+    argv.push_back(const_cast<char *>(str.c_str()));
+
+  argv.push_back(nullptr);
+  return argv.data();
+}
+
+// Programs, and invocations the wrapper does more with than executing a
+// single command, are not worth a round trip to the daemon.
+bool isDelegable(int argc, char **argv) {
+  const char *name = strrchr(argv[0], PATHDIV);
+  const char *p;
+  int archs = 0;
+
+  name = name ? name + 1 : argv[0];
+
+  // xcrun, x86_64-apple-darwinXX-ld, ...
+  if (program::getprog(name) ||
+      ((p = strstr(name, "-apple-darwin")) && (p = strchr(p + 13, '-')) &&
+       program::getprog(p + 1)))
+    return false;
+
+  const char *pchdir = getenv("OSXCROSS_SDK_PCH_DIR");
+
+  if (compilecache::getCacheDir() || (pchdir && *pchdir))
+    return false;
+
+  for (int i = 1; i < argc; ++i) {
+    // Universal builds may be split (fanout.h).
+    if (!strcmp(argv[i], "-foc-sdk-pch") ||
+        (!strcmp(argv[i], "-arch") && ++archs > 1))
+      return false;
+  }
+
+  return true;
+}
+
+//
+// Daemon
+//
+
+void onSignal(int) { stop = 1; }
+
+void sendReply(int fd, const char *status,
+               const std::string &path = std::string(),
+               const string_vector &args = string_vector(),
+               const string_vector &env = string_vector()) {
+  std::string data;
+
+  putRecord(data, std::string(ProtocolMagic));
+  putRecord(data, std::string(status));
+  putRecord(data, path);
+  putRecord(data, args);
+  putRecord(data, env);
+
+  writeAll(fd, data);
+}
+
+#ifdef __linux__
+constexpr uint32_t WatchMask = IN_ATTRIB | IN_CREATE | IN_DELETE |
+                               IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF |
+                               IN_MOVED_FROM | IN_MOVED_TO;
+
+int inotifyfd = -1;
+int exewd = -1;
+
+void watch(const std::string &path) {
+  if (inotifyfd != -1 && !path.empty())
+    inotify_add_watch(inotifyfd, path.c_str(), WatchMask);
+}
+
+// Returns false if the daemon must exit.
+bool handleWatchEvents() {
+  alignas(inotify_event) char buf[16384];
+  ssize_t len = read(inotifyfd, buf, sizeof(buf));
+
+  if (len <= 0)
+    return true;
+
+  for (char *p = buf; p < buf + len;) {
+    auto *event = reinterpret_cast<inotify_event *>(p);
+
+    if (event->wd == exewd && !(event->mask & IN_IGNORED)) {
+      info << "wrapper binary changed; exiting" << info.endl();
+      return false;
+    }
+
+    p += sizeof(inotify_event) + event->len;
+  }
+
+  if (debug)
+    dbg << "wrapperd: installation changed; dropping setup results"
+        << dbg.endl();
+
+  driver::forgetResolved();
+  return true;
+}
+#else
+void watch(const std::string &) {}
+#endif
+
+// The compiler's directory and the SDK of a resolved command.
+void watchToolchain(const std::string &compiler, const string_vector &args) {
+  std::string dir = compiler;
+  stripFileName(dir);
+  watch(dir);
+
+  for (size_t i = 0; i + 1 < args.size(); ++i) {
+    if (args[i] == "-isysroot")
+      watch(args[i + 1]);
+  }
+}
+
+// Replaces or adds "NAME=value".
+void setVariable(string_vector &env, const char *var) {
+  const char *eq = strchr(var, '=');
+  size_t len = eq ? eq - var + 1 : strlen(var);
+
+  for (auto &str : env) {
+    if (!str.compare(0, len, var, len)) {
+      str = var;
+      return;
+    }
+  }
+
+  env.push_back(var);
+}
+
+// The option parser prints debug messages if the daemon itself was started
+// with 'OCDEBUG' (env); those are not diagnostics of the invocation.
+bool hasDiagnostics(const char *text) {
+  constexpr const char *DebugPrefix = "osxcross: debug: ";
+
+  while (*text) {
+    const char *eol = strchr(text, '\n');
+
+    if (strncmp(text, DebugPrefix, strlen(DebugPrefix)))
+      return true;
+
+    if (!eol)
+      break;
+
+    text = eol + 1;
+  }
+
+  return false;
+}
+
+int listenOn(const char *path) {
+  sockaddr_un addr;
+  struct stat st;
+
+  if (!getSocketAddress(path, addr)) {
+    err << "socket path '" << path << "' is too long" << err.endl();
+    return -1;
+  }
+
+  int fd = connectTo(path);
+
+  if (fd != -1) {
+    close(fd);
+    err << "osxcross-wrapperd is already listening on '" << path << "'"
+        << err.endl();
+    return -1;
+  }
+
+  // Remove a stale socket left behind by a previous instance.
+  if (!lstat(path, &st) && S_ISSOCK(st.st_mode))
+    unlink(path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    err << "cannot create socket: " << strerror(errno) << err.endl();
+    return -1;
+  }
+
+  mode_t mask = umask(077);
+  int rc = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  umask(mask);
+
+  if (rc || listen(fd, SOMAXCONN)) {
+    err << "cannot listen on '" << path << "': " << strerror(errno)
+        << err.endl();
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+// Resolves one request in this process. Malformed requests are dropped;
+// the client then resolves the invocation itself.
+void handleRequest(int fd, const char *execpath) {
+  std::string request;
+  std::string str;
+  std::string cwd;
+  std::string clientpath;
+  string_vector args;
+  string_vector env;
+
+  setReceiveTimeout(fd);
+
+  if (!readAll(fd, request))
+    return;
+
+  const char *p = request.c_str();
+  const char *end = p + request.size();
+
+  if (!getRecord(p, end, str) || str != ProtocolMagic ||
+      !getRecord(p, end, clientpath) || !getRecord(p, end, cwd) ||
+      !getRecord(p, end, args) || !getRecord(p, end, env) || args.empty())
+    return;
+
+  // Only answer clients of the same installation.
+  if (clientpath != execpath || chdir(cwd.c_str())) {
+    sendReply(fd, "fallback");
+    return;
+  }
+
+  std::vector<const char *> argv;
+  std::vector<const char *> envp;
+
+  for (size_t i = 1; i < args.size(); ++i)
+    argv.push_back(args[i].c_str());
+
+  argv.push_back(nullptr);
+
+  for (auto &var : env)
+    envp.push_back(var.c_str());
+
+  envp.push_back(nullptr);
+
+  // Debug output would end up in the diagnostics and decline everything.
+  int daemonDebug = debug;
+  debug = 0;
+
+  osxcross_result *result =
+      osxcross_resolve(args[0].c_str(), argv.data(), envp.data());
+
+  debug = daemonDebug;
+
+  // Diagnostics must reach the user; let the client repeat the invocation.
+  if (result && osxcross_result_ok(result) &&
+      !hasDiagnostics(osxcross_result_diagnostics(result))) {
+    std::string compiler = osxcross_result_compiler(result);
+    string_vector cargs;
+
+    toStringVector(osxcross_result_argv(result), cargs);
+
+    for (char *const *var = osxcross_result_env(result); *var; ++var)
+      setVariable(env, *var);
+
+    sendReply(fd, "exec", compiler, cargs, env);
+    watchToolchain(compiler, cargs);
+  } else {
+    sendReply(fd, "fallback");
+
+    if (debug >= 2 && result)
+      dbg << "wrapperd: declined '" << args[0] << "':\n"
+          << osxcross_result_diagnostics(result) << dbg.endl();
+  }
+
+  if (result)
+    osxcross_result_free(result);
+
+  // Do not keep the client's directory busy.
+  if (chdir("/") && debug)
+    dbg << "wrapperd: cannot leave '" << cwd << "'" << dbg.endl();
+}
+
+} // anonymous namespace
+
+const char *getSocketPath() {
+  const char *path = getenv("OSXCROSS_WRAPPERD_SOCKET");
+  return path && *path ? path : nullptr;
+}
+
+//
+// Client
+//
+
+int execute(int argc, char **argv) {
+  time_type start = debug ? getNanoSeconds() : 0;
+  const char *socketPath = getSocketPath();
+  char execpath[PATH_MAX + 1];
+  char cwd[PATH_MAX + 1];
+  int fd;
+
+  if (!socketPath || !isDelegable(argc, argv) ||
+      (fd = connectTo(socketPath)) == -1)
+    return -1;
+
+  if (!getExecutablePath(execpath, sizeof(execpath)) ||
+      !getcwd(cwd, sizeof(cwd))) {
+    close(fd);
+    return -1;
+  }
+
+  setReceiveTimeout(fd);
+
+  std::string request;
+  std::string response;
+  string_vector args;
+  string_vector env;
+
+  toStringVector(argv, args);
+  args.resize(argc);
+  toStringVector(environ, env);
+
+  putRecord(request, std::string(ProtocolMagic));
+  putRecord(request, std::string(execpath));
+  putRecord(request, std::string(cwd));
+  putRecord(request, args);
+  putRecord(request, env);
+
+  bool ok = writeAll(fd, request) && !shutdown(fd, SHUT_WR) &&
+            readAll(fd, response);
+
+  close(fd);
+
+  const char *p = response.c_str();
+  const char *end = p + response.size();
+  std::string str;
+  std::string path;
+
+  if (!ok || !getRecord(p, end, str) || str != ProtocolMagic ||
+      !getRecord(p, end, str) || str != "exec" || !getRecord(p, end, path) ||
+      !getRecord(p, end, args) || !getRecord(p, end, env) || args.empty()) {
+    if (debug >= 2)
+      dbg << "wrapperd: invocation declined" << dbg.endl();
+    return -1;
+  }
+
+  if (debug) {
+    std::string out = path;
+
+    out += " (";
+    out += args[0];
+    out += ") ";
+
+    for (size_t i = 1; i < args.size(); ++i) {
+      out += args[i];
+      out += " ";
+    }
+
+    dbg << "resolved by osxcross-wrapperd (" << socketPath << ")"
+        << dbg.endl();
+    dbg << "<-- " << out << dbg.endl();
+    dbg << "=== time spent in wrapper: "
+        << (getNanoSeconds() - start) / 1000000.0 << " ms" << dbg.endl();
+  }
+
+  if (unittest == 2)
+    return 0;
+
+  std::vector<char *> argvbuf;
+  std::vector<char *> envbuf;
+
+  environ = toArgv(env, envbuf);
+  trace::exec(path.c_str());
+  execvp(path.c_str(), toArgv(args, argvbuf));
+
+  err << "invoking compiler failed" << err.endl();
+  return 1;
+}
+
+//
+// Daemon
+//
+
+bool isServer(const char *argv0) {
+  const char *name = strrchr(argv0, PATHDIV);
+  return endsWith(name ? name + 1 : argv0, "osxcross-wrapperd");
+}
+
+void serve(int argc, char **argv) {
+  const char *socketPath = argc > 1 ? argv[1] : getSocketPath();
+  char execpath[PATH_MAX + 1];
+
+  if (!socketPath) {
+    err << "usage: osxcross-wrapperd <socket>" << err.endl();
+    err << "(or set 'OSXCROSS_WRAPPERD_SOCKET' (env))" << err.endl();
+    exit(EXIT_FAILURE);
+  }
+
+  if (!getExecutablePath(execpath, sizeof(execpath)))
+    abort();
+
+  int listenfd = listenOn(socketPath);
+
+  if (listenfd == -1)
+    exit(EXIT_FAILURE);
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  unittest = 0;
+  trace::enabled = false;
+
+#ifdef __linux__
+  if ((inotifyfd = inotify_init()) != -1) {
+    if (char *exe = realpath("/proc/self/exe", nullptr)) {
+      exewd = inotify_add_watch(inotifyfd, exe,
+                                IN_ATTRIB | IN_MODIFY | IN_DELETE_SELF |
+                                IN_MOVE_SELF);
+      free(exe);
+    }
+
+    watch(execpath);
+    watch(getSDKSearchDir());
+  } else {
+    warn << "inotify unavailable; relying on file stamps" << warn.endl();
+  }
+#endif
+
+  info << "listening on '" << socketPath << "'" << info.endl();
+
+  std::vector<pollfd> fds;
+
+  // Requests are answered one after another; each one only takes a few
+  // file system lookups once its setup result is in memory.
+  while (!stop) {
+    fds.clear();
+    fds.push_back({ listenfd, POLLIN, 0 });
+#ifdef __linux__
+    fds.push_back({ inotifyfd, POLLIN, 0 });
+#endif
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      err << "poll() failed: " << strerror(errno) << err.endl();
+      break;
+    }
+
+#ifdef __linux__
+    if (fds[1].revents && !handleWatchEvents())
+      break;
+#endif
+
+    if (fds[0].revents) {
+      int fd = accept(listenfd, nullptr, nullptr);
+
+      if (fd != -1) {
+        handleRequest(fd, execpath);
+        close(fd);
+      }
+    }
+  }
+
+  unlink(socketPath);
+  exit(EXIT_SUCCESS);
+}
+
+} // namespace wrapperd
@@ -0,0 +1,53 @@
+/***********************************************************************
+ *  OSXCross Compiler Wrapper                                          *
+ *  Copyright (C) 2014-2026 by Thomas Poechtrager                      *
+ *  t.poechtrager@gmail.com                                            *
+ *                                                                     *
+ *  This program is free software; you can redistribute it and/or      *
+ *  modify it under the terms of the GNU General Public License        *
+ *  as published by the Free Software Foundation; either version 2     *
+ *  of the License, or (at your option) any later version.             *
+ *                                                                     *
+ *  This program is distributed in the hope that it will be useful,    *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ *  GNU General Public License for more details.                       *
+ *                                                                     *
+ *  You should have received a copy of the GNU General Public License  *
+ *  along with this program; if not, write to the Free Software        *
+ *  Foundation, Inc.,                                                  *
+ *  51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.      *
+ ***********************************************************************/
+
+namespace wrapperd {
+
+//
+// osxcross-wrapperd
+//
+// A resident process that resolves compiler invocations on behalf of the
+// wrapper. It listens on the Unix socket named by 'OSXCROSS_WRAPPERD_SOCKET'
+// (env) and resolves each request in its own process through
+// osxcross_resolve() (libosxcross.h), with the client's arguments,
+// environment and working directory. The client executes the command it
+// gets back.
+//
+// Setup results stay in the daemon's memory between requests (see
+// program::resolveCompiler()). They are dropped once the SDK, the compiler
+// or the wrapper installation change.
+//
+// Invocations the daemon cannot answer silently (programs, diagnostics,
+// errors) are declined and resolved by the client itself. So are those
+// the wrapper does more with than executing a single command: the compile
+// cache, SDK PCHs and universal builds that may be split.
+//
+
+const char *getSocketPath();
+
+// Client side. Returns -1 if the invocation has to be resolved in-process.
+int execute(int argc, char **argv);
+
+// Daemon side.
+bool isServer(const char *argv0);
+__attribute__((noreturn)) void serve(int argc, char **argv);
+
+} // namespace wrapperd